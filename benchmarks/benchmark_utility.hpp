@@ -78,12 +78,14 @@ namespace ultramarine::benchmark {
                                "\n\titerations   : %d"
                                "\n\tavr          : %lu us (%lu ms)"
                                "\n\tmin          : %lu us (%lu ms)"
+                               "\n\t99p          : %lu us (%lu ms)"
                                "\n\t99.9p        : %lu us (%lu ms)"
                                "\n\tstd          : %lu us (%lu ms)"
                                "\n\tTotal elapsed: %lu ms\n",
                                std::get<0>(bench), vec.size(),
                                sum / vec.size(), sum / vec.size() / 1000, // avr
                                *std::begin(vec), *std::begin(vec) / 1000, // min
+                               vec[vec.size() * 99 / 100], vec[vec.size() * 99 / 100] / 1000, // 99p
                                *(std::end(vec) - 1), *(std::end(vec) - 1) / 1000, // max
                                stDev(vec), stDev(vec) / 1000,
                                duration_cast<milliseconds>(high_resolution_clock::now() - bench_start).count());
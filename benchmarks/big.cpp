@@ -71,13 +71,162 @@ ULTRAMARINE_DEFINE_ACTOR(big_actor, (ping)(pong));
     void pong() const { };
 };
 
+class coalesced_big_actor : public ultramarine::actor<coalesced_big_actor>,
+                            public ultramarine::coalesced_actor<coalesced_big_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(coalesced_big_actor, (ping)(pong));
+    std::size_t pingpong_count = 0;
+
+    seastar::future<> ping() {
+        return ultramarine::with_buffer(100, [this] (auto &buffer) {
+            return seastar::do_until([this] { return pingpong_count >= PingPongCount; }, [this, &buffer] {
+                ++pingpong_count;
+                auto next = pseudo_random::nextInt(ActorCount);
+                return buffer(ultramarine::get<coalesced_big_actor>(next)->pong());
+            });
+        });
+    };
+
+    void pong() const { };
+};
+
+class staged_big_actor : public ultramarine::actor<staged_big_actor>,
+                         public ultramarine::staged_actor<staged_big_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(staged_big_actor, (ping)(pong));
+    std::size_t pingpong_count = 0;
+
+    seastar::future<> ping() {
+        return ultramarine::with_buffer(100, [this] (auto &buffer) {
+            return seastar::do_until([this] { return pingpong_count >= PingPongCount; }, [this, &buffer] {
+                ++pingpong_count;
+                auto next = pseudo_random::nextInt(ActorCount);
+                return buffer(ultramarine::get<staged_big_actor>(next)->pong());
+            });
+        });
+    };
+
+    void pong() const { };
+};
+
+// Actors only talk within their group, like tenants of a multi-tenant service
+static constexpr std::size_t GroupSize = 50;
+
+std::size_t next_in_group(std::size_t key) {
+    return key - key % GroupSize + pseudo_random::nextInt(GroupSize);
+}
+
+struct group_of {
+    std::size_t operator()(std::size_t key) const {
+        return key / GroupSize;
+    }
+};
+
+class grouped_big_actor : public ultramarine::actor<grouped_big_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(grouped_big_actor, (ping)(pong));
+    std::size_t pingpong_count = 0;
+
+    seastar::future<> ping() {
+        return ultramarine::with_buffer(100, [this] (auto &buffer) {
+            return seastar::do_until([this] { return pingpong_count >= PingPongCount; }, [this, &buffer] {
+                ++pingpong_count;
+                return buffer(ultramarine::get<grouped_big_actor>(next_in_group(key))->pong());
+            });
+        });
+    };
+
+    void pong() const { };
+};
+
+class numa_grouped_big_actor : public ultramarine::actor<numa_grouped_big_actor,
+        ultramarine::impl::numa_partitioned_placement_strategy<group_of>> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(numa_grouped_big_actor, (ping)(pong));
+    std::size_t pingpong_count = 0;
+
+    seastar::future<> ping() {
+        return ultramarine::with_buffer(100, [this] (auto &buffer) {
+            return seastar::do_until([this] { return pingpong_count >= PingPongCount; }, [this, &buffer] {
+                ++pingpong_count;
+                return buffer(ultramarine::get<numa_grouped_big_actor>(next_in_group(key))->pong());
+            });
+        });
+    };
+
+    void pong() const { };
+};
+
+thread_local std::size_t oneway_pongs = 0;
+
+class oneway_big_actor : public ultramarine::actor<oneway_big_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(oneway_big_actor, (ping)(pong));
+
+    void ping() {
+        for (std::size_t count = 0; count < PingPongCount; ++count) {
+            auto next = pseudo_random::nextInt(ActorCount);
+            ultramarine::get<oneway_big_actor>(next)->post_pong();
+        }
+    };
+
+    void pong() const {
+        ++oneway_pongs;
+    };
+};
+
 int i;
-seastar::future<> big() {
+
+template<typename Actor>
+seastar::future<> run_big() {
     i = 0;
-    return big_actor::clear_directory().then([] {
+    return Actor::clear_directory().then([] {
         return ultramarine::with_buffer(100, [] (auto &buffer) {
             return seastar::do_until([] { return i >= ActorCount; }, [&buffer] {
-                return buffer(ultramarine::get<big_actor>(i++)->ping());
+                return buffer(ultramarine::get<Actor>(i++)->ping());
+            });
+        });
+    });
+}
+
+seastar::future<> big() {
+    return run_big<big_actor>();
+}
+
+seastar::future<> coalesced_big() {
+    return run_big<coalesced_big_actor>();
+}
+
+seastar::future<> staged_big() {
+    return run_big<staged_big_actor>();
+}
+
+seastar::future<> grouped_big() {
+    return run_big<grouped_big_actor>();
+}
+
+// The topology is read from the system once. Run with --cpuset spanning two sockets to see groups stay on one node.
+seastar::future<> numa_grouped_big() {
+    static bool discovered = false;
+    auto topology = discovered ? seastar::make_ready_future() : ultramarine::discover_numa_topology();
+    discovered = true;
+    return topology.then([] {
+        return run_big<numa_grouped_big_actor>();
+    });
+}
+
+seastar::future<> oneway_big() {
+    return seastar::smp::invoke_on_all([] {
+        oneway_pongs = 0;
+    }).then([] {
+        return run_big<oneway_big_actor>();
+    }).then([] {
+        return seastar::repeat([] {
+            return seastar::map_reduce(boost::irange<seastar::shard_id>(0, seastar::smp::count), [](auto shard) {
+                return seastar::smp::submit_to(shard, [] { return oneway_pongs; });
+            }, std::size_t(0), std::plus<>()).then([](std::size_t pongs) {
+                return pongs >= PingPongCount * ActorCount ? seastar::stop_iteration::yes
+                                                           : seastar::stop_iteration::no;
             });
         });
     });
@@ -85,7 +234,15 @@ seastar::future<> big() {
 
 int main(int ac, char **av) {
     return ultramarine::benchmark::run(ac, av, {
-            ULTRAMARINE_BENCH(big)
+            ULTRAMARINE_BENCH(big),
+            ULTRAMARINE_BENCH(coalesced_big),
+            ULTRAMARINE_BENCH(staged_big),
+            ULTRAMARINE_BENCH(grouped_big),
+            ULTRAMARINE_BENCH(numa_grouped_big),
+#ifndef CLUSTERED_BENCHMARK
+            // Completion is detected by counting the handled messages on this node only
+            ULTRAMARINE_BENCH(oneway_big)
+#endif
     }, 10);
 
 }
\ No newline at end of file
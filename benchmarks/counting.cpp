@@ -44,9 +44,27 @@ ULTRAMARINE_DEFINE_ACTOR(counting_actor, (count)(increment));
     }
 };
 
+class batch_counting_actor : public ultramarine::actor<batch_counting_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(batch_counting_actor, (count)(increment));
+    std::size_t discovered = 0;
+
+    std::size_t count() const {
+        return discovered;
+    }
+
+    void increment() {
+        ++discovered;
+    }
+
+    void increment_batch(ultramarine::packed_arguments<> const &calls) {
+        discovered += std::size(calls);
+    }
+};
+
 class producer_actor : public ultramarine::actor<producer_actor> {
 public:
-ULTRAMARINE_DEFINE_ACTOR(producer_actor, (produce));
+ULTRAMARINE_DEFINE_ACTOR(producer_actor, (produce)(produce_stream));
     std::size_t produced;
 
     seastar::future<> produce(int counter_addr) {
@@ -62,6 +80,43 @@ ULTRAMARINE_DEFINE_ACTOR(producer_actor, (produce));
             });
         });
     }
+
+    seastar::future<> produce_stream(int counter_addr) {
+        auto counter = ultramarine::get<counting_actor>(counter_addr);
+
+        produced = 0;
+        return ultramarine::deduplicate_stream(counter, counting_actor::message::increment(), {},
+                                               [this](auto &increment) {
+            return seastar::do_until([this] { return produced == ProduceCount; }, [this, &increment] {
+                ++produced;
+                return increment();
+            });
+        }).then([this, counter] {
+            return counter->count().then([this](std::size_t discovered) {
+                assert(produced == discovered);
+            });
+        });
+    }
+};
+
+class batch_producer_actor : public ultramarine::actor<batch_producer_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(batch_producer_actor, (produce));
+    std::size_t produced;
+
+    seastar::future<> produce(int counter_addr) {
+        auto counter = ultramarine::get<batch_counting_actor>(counter_addr);
+
+        return ultramarine::deduplicate(counter, batch_counting_actor::message::increment(), [this] (auto &increment) {
+            for (produced = 0; produced < ProduceCount; ++produced) {
+                increment();
+            }
+        }).then([this, counter] {
+            return counter->count().then([this](std::size_t discovered) {
+                assert(produced == discovered);
+            });
+        });
+    }
 };
 
 seastar::future<> count_collocated() {
@@ -72,8 +127,26 @@ seastar::future<> count_collocated() {
     });
 }
 
+seastar::future<> count_collocated_stream() {
+    return producer_actor::clear_directory().then([] {
+        return counting_actor::clear_directory().then([] {
+            return ultramarine::get<producer_actor>(0)->produce_stream(1);
+        });
+    });
+}
+
+seastar::future<> count_collocated_batch() {
+    return batch_producer_actor::clear_directory().then([] {
+        return batch_counting_actor::clear_directory().then([] {
+            return ultramarine::get<batch_producer_actor>(0)->produce(1);
+        });
+    });
+}
+
 int main(int ac, char **av) {
     return ultramarine::benchmark::run(ac, av, {
             ULTRAMARINE_BENCH(count_collocated),
+            ULTRAMARINE_BENCH(count_collocated_stream),
+            ULTRAMARINE_BENCH(count_collocated_batch),
     }, 100);
 }
\ No newline at end of file
@@ -0,0 +1,113 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <boost/range/irange.hpp>
+#include <seastar/core/future-util.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t JobCount = 4096;
+static constexpr std::size_t LongJobPeriod = 8;
+static constexpr std::size_t ShortJobWork = 2000;
+static constexpr std::size_t LongJobWork = 100000;
+
+static thread_local std::chrono::steady_clock::duration busy{};
+
+void spin(std::size_t work) {
+    static thread_local volatile std::size_t sink;
+    auto start = std::chrono::steady_clock::now();
+    std::size_t seed = work;
+    for (std::size_t i = 0; i < work; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    sink = seed;
+    busy += std::chrono::steady_clock::now() - start;
+}
+
+class round_robin_worker : public ultramarine::actor<round_robin_worker>,
+                           public ultramarine::local_actor<round_robin_worker> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(round_robin_worker, (job));
+
+    void job(std::size_t work) const {
+        spin(work);
+    }
+};
+
+class stealing_worker : public ultramarine::actor<stealing_worker>,
+                        public ultramarine::local_actor<stealing_worker>,
+                        public ultramarine::work_stealing_actor<stealing_worker> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(stealing_worker, (job));
+
+    void job(std::size_t work) const {
+        spin(work);
+    }
+};
+
+// Every LongJobPeriod-th job is fifty times longer than the others, so round robin keeps sending the long ones to the
+// same shards. Makespan and per-shard utilization, the time spent in jobs over the makespan, are those of the first
+// run.
+template<typename Worker>
+seastar::future<> fork_join() {
+    static bool reported = false;
+    auto start = std::chrono::steady_clock::now();
+    return seastar::smp::invoke_on_all([] {
+        busy = {};
+    }).then([] {
+        return seastar::parallel_for_each(boost::irange<std::size_t>(0, JobCount), [](auto i) {
+            return ultramarine::get<Worker>(0)->job(i % LongJobPeriod ? ShortJobWork : LongJobWork);
+        });
+    }).then([start] {
+        auto makespan = std::chrono::steady_clock::now() - start;
+        if (reported) {
+            return seastar::make_ready_future();
+        }
+        reported = true;
+        seastar::print("\tmakespan     : %dus\n",
+                       std::chrono::duration_cast<std::chrono::microseconds>(makespan).count());
+        return seastar::do_for_each(boost::irange<seastar::shard_id>(0, seastar::smp::count), [makespan](auto shard) {
+            return seastar::smp::submit_to(shard, [] { return busy; }).then([shard, makespan](auto spent) {
+                seastar::print("\tshard %-6d : %.0f%% busy\n", shard, 100.0 * spent.count() / makespan.count());
+            });
+        });
+    });
+}
+
+seastar::future<> round_robin() {
+    return fork_join<round_robin_worker>();
+}
+
+seastar::future<> work_stealing() {
+    return fork_join<stealing_worker>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(round_robin),
+            ULTRAMARINE_BENCH(work_stealing),
+    }, 10);
+}
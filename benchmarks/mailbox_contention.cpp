@@ -0,0 +1,91 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include <ultramarine/utility.hpp>
+#include "benchmark_utility.hpp"
+#include <seastar/core/future-util.hh>
+
+static constexpr std::size_t NumMessage = 100;
+static constexpr std::size_t SenderCount = 1000;
+
+class contended_receiver : public ultramarine::actor<contended_receiver>,
+                           public ultramarine::non_reentrant_actor<contended_receiver> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(contended_receiver, (receive)(receive_future));
+    std::size_t received = 0;
+
+    void receive() {
+        ++received;
+    };
+
+    seastar::future<> receive_future() {
+        ++received;
+        return seastar::make_ready_future();
+    };
+};
+
+class contending_sender : public ultramarine::actor<contending_sender> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(contending_sender, (send)(send_future));
+
+    seastar::future<> send(ultramarine::actor_id whom) {
+        return ultramarine::with_buffer(NumMessage, [whom](auto &buffer) {
+            return seastar::do_for_each(boost::irange<std::size_t>(0, NumMessage), [whom, &buffer](auto) {
+                return buffer(ultramarine::get<contended_receiver>(whom)->receive());
+            });
+        });
+    };
+
+    seastar::future<> send_future(ultramarine::actor_id whom) {
+        return ultramarine::with_buffer(NumMessage, [whom](auto &buffer) {
+            return seastar::do_for_each(boost::irange<std::size_t>(0, NumMessage), [whom, &buffer](auto) {
+                return buffer(ultramarine::get<contended_receiver>(whom)->receive_future());
+            });
+        });
+    };
+};
+
+template<typename Message>
+seastar::future<> contend(Message message) {
+    return seastar::parallel_for_each(boost::irange<std::size_t>(0, SenderCount), [message](auto i) {
+        return ultramarine::get<contending_sender>(i).tell(message, 0);
+    });
+}
+
+seastar::future<> non_reentrant_contention() {
+    return contend(contending_sender::message::send());
+}
+
+seastar::future<> non_reentrant_contention_future() {
+    return contend(contending_sender::message::send_future());
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(non_reentrant_contention),
+            ULTRAMARINE_BENCH(non_reentrant_contention_future)
+    }, 10);
+}
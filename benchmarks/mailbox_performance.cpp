@@ -40,6 +40,31 @@ ULTRAMARINE_DEFINE_ACTOR(receiver, (receive));
     };
 };
 
+class coalesced_receiver : public ultramarine::actor<coalesced_receiver>,
+                           public ultramarine::coalesced_actor<coalesced_receiver> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(coalesced_receiver, (receive));
+    std::size_t received = 0;
+
+    void receive() {
+        ++received;
+    };
+};
+
+class oneway_receiver : public ultramarine::actor<oneway_receiver> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(oneway_receiver, (receive)(get_received));
+    std::size_t received = 0;
+
+    void receive() {
+        ++received;
+    };
+
+    std::size_t get_received() const {
+        return received;
+    }
+};
+
 class sender : public ultramarine::actor<sender> {
 public:
 ULTRAMARINE_DEFINE_ACTOR(sender, (send));
@@ -54,14 +79,63 @@ ULTRAMARINE_DEFINE_ACTOR(sender, (send));
     };
 };
 
+class coalesced_sender : public ultramarine::actor<coalesced_sender> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(coalesced_sender, (send));
+    std::size_t sent = 0;
+
+    seastar::future<> send(ultramarine::actor_id whom) {
+        return seastar::do_with(ultramarine::get<coalesced_receiver>(whom), [this](auto const &whom) {
+            return seastar::do_until([this] { return sent++ >= NumMessage; }, [&whom] {
+                return whom->receive();
+            });
+        });
+    };
+};
+
+class oneway_sender : public ultramarine::actor<oneway_sender> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(oneway_sender, (send));
+    std::size_t sent = 0;
+
+    void send(ultramarine::actor_id whom) {
+        auto receiver = ultramarine::get<oneway_receiver>(whom);
+        while (sent++ < NumMessage) {
+            receiver->post_receive();
+        }
+    };
+};
+
 thread_local static int i;
 
-seastar::future<> mailbox_performance() {
+template<typename Sender>
+seastar::future<> run_senders() {
     i = 0;
-    return sender::clear_directory().then([] {
+    return Sender::clear_directory().then([] {
         return ultramarine::with_buffer(SenderCount, [](auto &buffer) {
             return seastar::do_until([] { return i >= SenderCount; }, [&buffer] {
-                return buffer(ultramarine::get<sender>(i++)->send(0));
+                return buffer(ultramarine::get<Sender>(i++)->send(0));
+            });
+        });
+    });
+}
+
+seastar::future<> mailbox_performance() {
+    return run_senders<sender>();
+}
+
+seastar::future<> coalesced_mailbox_performance() {
+    return run_senders<coalesced_sender>();
+}
+
+seastar::future<> oneway_mailbox_performance() {
+    return oneway_receiver::clear_directory().then([] {
+        return run_senders<oneway_sender>();
+    }).then([] {
+        return seastar::repeat([] {
+            return ultramarine::get<oneway_receiver>(0)->get_received().then([](std::size_t received) {
+                return received >= NumMessage * SenderCount ? seastar::stop_iteration::yes
+                                                            : seastar::stop_iteration::no;
             });
         });
     });
@@ -69,6 +143,11 @@ seastar::future<> mailbox_performance() {
 
 int main(int ac, char **av) {
     return ultramarine::benchmark::run(ac, av, {
-            ULTRAMARINE_BENCH(mailbox_performance)
+            ULTRAMARINE_BENCH(mailbox_performance),
+            ULTRAMARINE_BENCH(coalesced_mailbox_performance),
+#ifndef CLUSTERED_BENCHMARK
+            // Completion is detected by counting the handled messages on this node only
+            ULTRAMARINE_BENCH(oneway_mailbox_performance)
+#endif
     }, 10);
 }
\ No newline at end of file
@@ -22,6 +22,7 @@
  * SOFTWARE.
  */
 
+#include <boost/range/irange.hpp>
 #include <ultramarine/actor.hpp>
 #include <ultramarine/actor_ref.hpp>
 #include <ultramarine/message_deduplicate.hpp>
@@ -30,6 +31,8 @@
 
 class counter_actor : public ultramarine::actor<counter_actor> {
 public:
+    using Hasher = ultramarine::identity_key_hasher;
+
     volatile int counter = 0;
 
     seastar::future<> increase_counter_future() {
@@ -67,6 +70,82 @@ ULTRAMARINE_DEFINE_ACTOR(counter_actor,
                                  (accumulate_future)(accumulate_value)(noop));
 };
 
+class direct_counter_actor : public ultramarine::actor<direct_counter_actor>,
+                             public ultramarine::direct_dispatch_actor<direct_counter_actor> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    volatile int counter = 0;
+
+    seastar::future<> increase_counter_future() {
+        counter++;
+        return seastar::make_ready_future();
+    }
+
+    seastar::future<int> noop(int i) const {
+        return seastar::make_ready_future<int>(i);
+    }
+
+    void increase_counter_void() {
+        counter++;
+    }
+
+    seastar::future<int> get_counter_future() const {
+        return seastar::make_ready_future<int>(counter);
+    }
+
+    int get_counter_int() const {
+        return counter;
+    }
+
+    seastar::future<int> accumulate_future(std::vector<int> pack) const {
+        return seastar::make_ready_future<int>(std::accumulate(std::begin(pack), std::end(pack), 0));
+    }
+
+    int accumulate_value(std::vector<int> pack) const {
+        return std::accumulate(std::begin(pack), std::end(pack), 0);
+    }
+
+ULTRAMARINE_DEFINE_ACTOR(direct_counter_actor,
+                         (increase_counter_future)(increase_counter_void)
+                                 (get_counter_future)(get_counter_int)
+                                 (accumulate_future)(accumulate_value)(noop));
+};
+
+class staged_counter_actor : public ultramarine::actor<staged_counter_actor>,
+                             public ultramarine::staged_actor<staged_counter_actor> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    volatile int counter = 0;
+
+    seastar::future<int> noop(int i) const {
+        return seastar::make_ready_future<int>(i);
+    }
+
+    void increase_counter_void() {
+        counter++;
+    }
+
+    int get_counter_int() const {
+        return counter;
+    }
+
+ULTRAMARINE_DEFINE_ACTOR(staged_counter_actor, (increase_counter_void)(get_counter_int)(noop));
+};
+
+class string_counter_actor : public ultramarine::actor<string_counter_actor> {
+public:
+    using KeyType = std::string;
+    volatile int counter = 0;
+
+    void increase_counter_void() {
+        counter++;
+    }
+
+ULTRAMARINE_DEFINE_ACTOR(string_counter_actor, (increase_counter_void));
+};
+
 /*
  * PLAIN OBJECT
  */
@@ -225,6 +304,85 @@ auto local_actor_int_args() {
     });
 }
 
+/*
+ * LOCAL ACTOR (DIRECT DISPATCH)
+ */
+
+auto local_direct_actor_void_future() {
+    int *counter = new int(0);
+
+    auto counterActor = ultramarine::get<direct_counter_actor>(0);
+    return seastar::do_until([counter] {
+        return *counter >= 10000;
+    }, [counterActor, counter]() mutable {
+        ++*counter;
+        return counterActor.tell(direct_counter_actor::message::increase_counter_future());
+    });
+
+}
+
+auto local_direct_actor_void() {
+    int *counter = new int(0);
+
+    auto counterActor = ultramarine::get<direct_counter_actor>(0);
+    return seastar::do_until([counter] {
+        return *counter >= 10000;
+    }, [counterActor, counter]() mutable {
+        ++*counter;
+        return counterActor.tell(direct_counter_actor::message::increase_counter_void());
+    });
+}
+
+auto local_direct_actor_int_future() {
+    int *counter = new int(0);
+
+    auto counterActor = ultramarine::get<direct_counter_actor>(0);
+    return seastar::do_until([counter] {
+        return *counter >= 10000;
+    }, [counterActor, counter]() {
+        ++*counter;
+        return counterActor.tell(direct_counter_actor::message::get_counter_future()).discard_result();
+    });
+}
+
+auto local_direct_actor_int() {
+    int *counter = new int(0);
+
+    auto counterActor = ultramarine::get<direct_counter_actor>(0);
+    return seastar::do_until([counter] {
+        return *counter >= 10000;
+    }, [counterActor, counter]() {
+        ++*counter;
+        return counterActor.tell(direct_counter_actor::message::get_counter_int()).discard_result();
+    });
+}
+
+auto local_direct_actor_future_args() {
+    int *counter = new int(0);
+
+    auto counterActor = ultramarine::get<direct_counter_actor>(0);
+    return seastar::do_until([counter] {
+        return *counter >= 10000;
+    }, [counterActor, counter]() {
+        ++*counter;
+        return counterActor.tell(direct_counter_actor::message::accumulate_future(),
+                                 std::vector<int>{10, 12, 30, *counter}).discard_result();
+    });
+}
+
+auto local_direct_actor_int_args() {
+    int *counter = new int(0);
+
+    auto counterActor = ultramarine::get<direct_counter_actor>(0);
+    return seastar::do_until([counter] {
+        return *counter >= 10000;
+    }, [counterActor, counter]() {
+        ++*counter;
+        return counterActor.tell(direct_counter_actor::message::accumulate_value(),
+                                 std::vector<int>{10, 12, 30, *counter}).discard_result();
+    });
+}
+
 /*
  * LOCAL ACTOR (DEDUPLICATED)
  */
@@ -311,6 +469,30 @@ auto collocated_actor_void() {
     });
 }
 
+auto collocated_string_key_actor_void() {
+    int *counter = new int(0);
+
+    auto counterActor = ultramarine::get<string_counter_actor>(std::string(64, 'k'));
+    return seastar::do_until([counter] {
+        return *counter >= 10000;
+    }, [counterActor, counter]() mutable {
+        ++*counter;
+        return counterActor.tell(string_counter_actor::message::increase_counter_void());
+    });
+}
+
+auto collocated_string_key_actor_get_void() {
+    int *counter = new int(0);
+
+    return seastar::do_until([counter] {
+        return *counter >= 10000;
+    }, [counter]() mutable {
+        ++*counter;
+        auto ref = ultramarine::get<string_counter_actor>(std::string(64, 'k'));
+        return ref.tell(string_counter_actor::message::increase_counter_void());
+    });
+}
+
 auto collocated_actor_int_future() {
     int *counter = new int(0);
 
@@ -419,37 +601,87 @@ auto collocated_actor_deduplicated_int_args() {
     }).discard_result();
 }
 
+/*
+ * MIXED HANDLERS
+ * Many messages of different types in flight at once, so that handler types interleave on the receiving shard
+ */
+
+template<typename Actor>
+auto mixed_handlers(std::size_t key) {
+    return ultramarine::with_buffer(100, [key](auto &buffer) {
+        return seastar::do_for_each(boost::irange(0, 10000), [key, &buffer](int i) {
+            auto counterActor = ultramarine::get<Actor>(key);
+            switch (i % 3) {
+                case 0:
+                    return buffer(counterActor.tell(Actor::message::increase_counter_void()));
+                case 1:
+                    return buffer(counterActor.tell(Actor::message::get_counter_int()).discard_result());
+                default:
+                    return buffer(counterActor.tell(Actor::message::noop(), i).discard_result());
+            }
+        });
+    });
+}
+
+auto local_actor_mixed_handlers() {
+    return mixed_handlers<counter_actor>(0);
+}
+
+auto local_staged_actor_mixed_handlers() {
+    return mixed_handlers<staged_counter_actor>(0);
+}
+
+auto collocated_actor_mixed_handlers() {
+    return mixed_handlers<counter_actor>(1);
+}
+
+auto collocated_staged_actor_mixed_handlers() {
+    return mixed_handlers<staged_counter_actor>(1);
+}
+
 int main(int ac, char **av) {
     return ultramarine::benchmark::run(ac, av, {
             ULTRAMARINE_BENCH(plain_object_void_future),
             ULTRAMARINE_BENCH(local_actor_void_future),
+            ULTRAMARINE_BENCH(local_direct_actor_void_future),
             ULTRAMARINE_BENCH(local_actor_deduplicated_void_future),
             ULTRAMARINE_BENCH(collocated_actor_void_future),
             ULTRAMARINE_BENCH(collocated_actor_deduplicated_void_future),
             ULTRAMARINE_BENCH(plain_object_void),
             ULTRAMARINE_BENCH(local_actor_void),
+            ULTRAMARINE_BENCH(local_direct_actor_void),
             ULTRAMARINE_BENCH(local_actor_deduplicated_void),
             ULTRAMARINE_BENCH(collocated_actor_void),
             ULTRAMARINE_BENCH(collocated_actor_deduplicated_void),
+            ULTRAMARINE_BENCH(collocated_string_key_actor_void),
+            ULTRAMARINE_BENCH(collocated_string_key_actor_get_void),
             ULTRAMARINE_BENCH(plain_object_int_future),
             ULTRAMARINE_BENCH(local_actor_int_future),
+            ULTRAMARINE_BENCH(local_direct_actor_int_future),
             ULTRAMARINE_BENCH(local_actor_deduplicated_int_future),
             ULTRAMARINE_BENCH(collocated_actor_int_future),
             ULTRAMARINE_BENCH(collocated_actor_deduplicated_int_future),
             ULTRAMARINE_BENCH(plain_object_int),
             ULTRAMARINE_BENCH(local_actor_int),
+            ULTRAMARINE_BENCH(local_direct_actor_int),
             ULTRAMARINE_BENCH(local_actor_deduplicated_int),
             ULTRAMARINE_BENCH(collocated_actor_int),
             ULTRAMARINE_BENCH(collocated_actor_deduplicated_int),
             ULTRAMARINE_BENCH(plain_object_future_args),
             ULTRAMARINE_BENCH(local_actor_future_args),
+            ULTRAMARINE_BENCH(local_direct_actor_future_args),
             ULTRAMARINE_BENCH(local_actor_deduplicated_future_args),
             ULTRAMARINE_BENCH(collocated_actor_future_args),
             ULTRAMARINE_BENCH(collocated_actor_deduplicated_future_args),
             ULTRAMARINE_BENCH(plain_object_int_args),
             ULTRAMARINE_BENCH(local_actor_int_args),
+            ULTRAMARINE_BENCH(local_direct_actor_int_args),
             ULTRAMARINE_BENCH(local_actor_deduplicated_int_args),
             ULTRAMARINE_BENCH(collocated_actor_int_args),
-            ULTRAMARINE_BENCH(collocated_actor_deduplicated_int_args)
+            ULTRAMARINE_BENCH(collocated_actor_deduplicated_int_args),
+            ULTRAMARINE_BENCH(local_actor_mixed_handlers),
+            ULTRAMARINE_BENCH(local_staged_actor_mixed_handlers),
+            ULTRAMARINE_BENCH(collocated_actor_mixed_handlers),
+            ULTRAMARINE_BENCH(collocated_staged_actor_mixed_handlers)
     }, 1000);
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include <ultramarine/utility.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t MessageCount = 10000;
+
+class sink_actor : public ultramarine::actor<sink_actor> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(sink_actor, (consume));
+    std::size_t consumed = 0;
+
+    void consume(std::vector<char> const &payload) {
+        consumed += std::size(payload);
+    }
+};
+
+template<std::size_t PayloadSize, bool Handoff>
+seastar::future<> run_payload() {
+    return sink_actor::clear_directory().then([] {
+        return seastar::do_with(std::size_t(0), [](auto &i) {
+            return ultramarine::with_buffer(100, [&i](auto &buffer) {
+                return seastar::do_until([&i] { return i >= MessageCount; }, [&i, &buffer] {
+                    auto sink = ultramarine::get<sink_actor>(seastar::smp::count > 1 ? 1 : 0);
+                    std::vector<char> payload(PayloadSize);
+                    ++i;
+                    if constexpr (Handoff) {
+                        return buffer(sink->consume(std::move(payload)));
+                    } else {
+                        return buffer(sink->consume(payload));
+                    }
+                });
+            });
+        });
+    });
+}
+
+seastar::future<> copy_64k() {
+    return run_payload<64 * 1024, false>();
+}
+
+seastar::future<> handoff_64k() {
+    return run_payload<64 * 1024, true>();
+}
+
+seastar::future<> copy_256k() {
+    return run_payload<256 * 1024, false>();
+}
+
+seastar::future<> handoff_256k() {
+    return run_payload<256 * 1024, true>();
+}
+
+seastar::future<> copy_1m() {
+    return run_payload<1024 * 1024, false>();
+}
+
+seastar::future<> handoff_1m() {
+    return run_payload<1024 * 1024, true>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(copy_64k),
+            ULTRAMARINE_BENCH(handoff_64k),
+            ULTRAMARINE_BENCH(copy_256k),
+            ULTRAMARINE_BENCH(handoff_256k),
+            ULTRAMARINE_BENCH(copy_1m),
+            ULTRAMARINE_BENCH(handoff_1m),
+    }, 10);
+}
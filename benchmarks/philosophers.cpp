@@ -73,6 +73,83 @@ ULTRAMARINE_DEFINE_ACTOR(philosopher_actor, (start));
     }
 };
 
+// Philosophers and their arbitrator share a partition, the table they sit at, and are therefore collocated
+
+struct seat {
+    std::size_t table = 0;
+    std::size_t index = 0;
+
+    bool operator==(seat const &rhs) const {
+        return table == rhs.table && index == rhs.index;
+    }
+};
+
+namespace std {
+    template<>
+    struct hash<seat> {
+        std::size_t operator()(seat const &s) const {
+            return s.table * PhilosopherLen + s.index;
+        }
+    };
+}
+
+struct table_of {
+    std::size_t operator()(std::size_t table) const {
+        return table;
+    }
+
+    std::size_t operator()(seat const &s) const {
+        return s.table;
+    }
+};
+
+using table_placement_strategy = ultramarine::impl::partitioned_placement_strategy<table_of>;
+
+class partitioned_arbitrator_actor : public ultramarine::actor<partitioned_arbitrator_actor, table_placement_strategy> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(partitioned_arbitrator_actor, (hungry)(done));
+    std::array<bool, PhilosopherLen> forks{};
+
+    seastar::future<bool> hungry(int philosopher_index) {
+        auto &leftFork = forks[philosopher_index];
+        auto &rightFork = forks[(philosopher_index + 1) % PhilosopherLen];
+
+        if (leftFork || rightFork) {
+            return seastar::make_ready_future<bool>(false);
+        } else {
+            return seastar::make_ready_future<bool>(leftFork = rightFork = true);
+        }
+    }
+
+    void done(int philosopher_index) {
+        forks[philosopher_index] = false;
+        forks[(philosopher_index + 1) % PhilosopherLen] = false;
+    }
+};
+
+class partitioned_philosopher_actor : public ultramarine::actor<partitioned_philosopher_actor,
+        table_placement_strategy> {
+public:
+    using KeyType = seat;
+
+ULTRAMARINE_DEFINE_ACTOR(partitioned_philosopher_actor, (start));
+    int round = 0;
+
+    seastar::future<> start() {
+        auto arbitrator = ultramarine::get<partitioned_arbitrator_actor>(key.table);
+        return seastar::do_until([this] { return round >= RoundLen; }, [this, arbitrator] {
+            return arbitrator->hungry(key.index).then([this, arbitrator](bool allowed) {
+                if (allowed) {
+                    ++round;
+                    return arbitrator.tell(partitioned_arbitrator_actor::message::done(), key.index);
+                }
+                ++failed_attempts;
+                return seastar::make_ready_future();
+            });
+        });
+    }
+};
+
 seastar::future<> dinning_philosophers() {
     failed_attempts = 0;
     return philosopher_actor::clear_directory().then([] {
@@ -86,8 +163,22 @@ seastar::future<> dinning_philosophers() {
     });
 }
 
+seastar::future<> partitioned_dinning_philosophers() {
+    failed_attempts = 0;
+    return partitioned_philosopher_actor::clear_directory().then([] {
+        return partitioned_arbitrator_actor::clear_directory().then([] {
+            return seastar::parallel_for_each(boost::irange(0UL, PhilosopherLen), [](std::size_t philo) {
+                return ultramarine::get<partitioned_philosopher_actor>(seat{0, philo})->start();
+            }).then([] {
+                seastar::print("performed a total of %d failed attempt\n", failed_attempts.load());
+            });
+        });
+    });
+}
+
 int main(int ac, char **av) {
     return ultramarine::benchmark::run(ac, av, {
             ULTRAMARINE_BENCH(dinning_philosophers),
+            ULTRAMARINE_BENCH(partitioned_dinning_philosophers),
     }, 10);
 }
\ No newline at end of file
@@ -56,12 +56,87 @@ seastar::future<> ping_actor::ping_pong(int pong_addr) {
 
 void pong_actor::pong() const {}
 
+// Shards are picked in order among the shards of a NUMA node, so keys 0 and 1 of the same node land on two
+// different shards of that node
+template<unsigned Node>
+using numa_placement = ultramarine::impl::numa_node_placement_strategy<Node,
+        ultramarine::impl::round_robin_local_placement_strategy>;
+
+class same_node_pong_actor : public ultramarine::actor<same_node_pong_actor, numa_placement<0>> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(same_node_pong_actor, (pong));
+
+    void pong() const {}
+};
+
+class other_node_pong_actor : public ultramarine::actor<other_node_pong_actor, numa_placement<1>> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(other_node_pong_actor, (pong));
+
+    void pong() const {}
+};
+
+class numa_ping_actor : public ultramarine::actor<numa_ping_actor, numa_placement<0>> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(numa_ping_actor, (ping_same_node)(ping_other_node));
+    std::size_t pingpong_count = 0;
+
+    template<typename Pong>
+    seastar::future<> ping_pong(int pong_addr) {
+        pingpong_count = 0;
+        auto pong = ultramarine::get<Pong>(pong_addr);
+        return seastar::do_until([this] { return pingpong_count >= PingPongCount; }, [this, pong] {
+            return pong->pong().then([this] {
+                ++pingpong_count;
+            });
+        });
+    }
+
+    seastar::future<> ping_same_node() {
+        return ping_pong<same_node_pong_actor>(1);
+    }
+
+    seastar::future<> ping_other_node() {
+        return ping_pong<other_node_pong_actor>(0);
+    }
+};
+
+// The topology is read from the system once. Run with --cpuset spanning two sockets to compare both placements.
+seastar::future<> with_numa_topology() {
+    static bool discovered = false;
+    if (discovered) {
+        return seastar::make_ready_future();
+    }
+    discovered = true;
+    return ultramarine::discover_numa_topology();
+}
+
 seastar::future<> pingpong_collocated() {
     return ultramarine::get<ping_actor>(0)->ping_pong(1);
 }
 
+seastar::future<> pingpong_same_node() {
+    return with_numa_topology().then([] {
+        return ultramarine::get<numa_ping_actor>(0)->ping_same_node();
+    });
+}
+
+seastar::future<> pingpong_other_node() {
+    return with_numa_topology().then([] {
+        return ultramarine::get<numa_ping_actor>(0)->ping_other_node();
+    });
+}
+
 int main(int ac, char **av) {
     return ultramarine::benchmark::run(ac, av, {
-            ULTRAMARINE_BENCH(pingpong_collocated)
+            ULTRAMARINE_BENCH(pingpong_collocated),
+            ULTRAMARINE_BENCH(pingpong_same_node),
+            ULTRAMARINE_BENCH(pingpong_other_node)
     }, 10);
 }
\ No newline at end of file
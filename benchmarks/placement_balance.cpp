@@ -0,0 +1,180 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <random>
+#include <boost/range/irange.hpp>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include <ultramarine/utility.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t MessageCount = 100000;
+static constexpr std::size_t ZipfianKeyCount = 10000;
+static constexpr std::size_t PlacementCount = 1000000;
+
+class mixed_actor : public ultramarine::actor<mixed_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(mixed_actor, (receive));
+    static inline thread_local std::size_t received = 0;
+
+    void receive() const {
+        ++received;
+    }
+};
+
+class identity_actor : public ultramarine::actor<identity_actor> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(identity_actor, (receive));
+    static inline thread_local std::size_t received = 0;
+
+    void receive() const {
+        ++received;
+    }
+};
+
+ultramarine::actor_id sequential_key(std::size_t i) {
+    return i;
+}
+
+ultramarine::actor_id strided_key(std::size_t i) {
+    return i * seastar::smp::count;
+}
+
+ultramarine::actor_id zipfian_key(std::size_t i) {
+    static thread_local std::vector<ultramarine::actor_id> keys = [] {
+        std::vector<double> cdf(ZipfianKeyCount);
+        double sum = 0;
+        for (std::size_t rank = 0; rank < ZipfianKeyCount; ++rank) {
+            cdf[rank] = sum += 1.0 / (rank + 1);
+        }
+        std::mt19937_64 engine(74755);
+        std::uniform_real_distribution<double> distribution(0, sum);
+        std::vector<ultramarine::actor_id> drawn(MessageCount);
+        for (auto &key : drawn) {
+            key = std::lower_bound(std::begin(cdf), std::end(cdf), distribution(engine)) - std::begin(cdf);
+        }
+        return drawn;
+    }();
+    return keys[i];
+}
+
+// Skew is the number of messages handled by the busiest shard over the average. 1.0 is a perfect balance.
+template<typename Actor, ultramarine::actor_id (*Key)(std::size_t)>
+seastar::future<> balance() {
+    static bool reported = false;
+    return seastar::smp::invoke_on_all([] {
+        Actor::received = 0;
+    }).then([] {
+        return ultramarine::with_buffer(100, [](auto &buffer) {
+            return seastar::do_for_each(boost::irange<std::size_t>(0, MessageCount), [&buffer](auto i) {
+                return buffer(ultramarine::get<Actor>(Key(i))->receive());
+            });
+        });
+    }).then([] {
+        return seastar::map_reduce(boost::irange<seastar::shard_id>(0, seastar::smp::count), [](auto shard) {
+            return seastar::smp::submit_to(shard, [] { return Actor::received; });
+        }, std::size_t(0), [](std::size_t busiest, std::size_t received) {
+            return std::max(busiest, received);
+        }).then([](std::size_t busiest) {
+            if (!reported) {
+                reported = true;
+                seastar::print("\tskew         : %.2f\n", busiest / (MessageCount / (double) seastar::smp::count));
+            }
+        });
+    });
+}
+
+seastar::future<> identity_sequential() {
+    return balance<identity_actor, sequential_key>();
+}
+
+seastar::future<> mixed_sequential() {
+    return balance<mixed_actor, sequential_key>();
+}
+
+seastar::future<> identity_strided() {
+    return balance<identity_actor, strided_key>();
+}
+
+seastar::future<> mixed_strided() {
+    return balance<mixed_actor, strided_key>();
+}
+
+seastar::future<> identity_zipfian() {
+    return balance<identity_actor, zipfian_key>();
+}
+
+seastar::future<> mixed_zipfian() {
+    return balance<mixed_actor, zipfian_key>();
+}
+
+// Placement cost per key is the average run time over PlacementCount
+template<typename Strategy>
+seastar::future<> placement_cost() {
+    static volatile seastar::shard_id sink;
+    Strategy strategy;
+    for (std::size_t i = 0; i < PlacementCount; ++i) {
+        sink = strategy(ultramarine::default_key_hasher{}(i));
+    }
+    return seastar::make_ready_future();
+}
+
+seastar::future<> round_robin_cost() {
+    return placement_cost<ultramarine::impl::round_robin_local_placement_strategy>();
+}
+
+seastar::future<> jump_consistent_hash_cost() {
+    return placement_cost<ultramarine::impl::jump_consistent_hash_placement_strategy>();
+}
+
+seastar::future<> rendezvous_cost() {
+    return placement_cost<ultramarine::impl::rendezvous_placement_strategy>();
+}
+
+seastar::future<> contiguous_cost() {
+    return placement_cost<ultramarine::impl::contiguous_placement_strategy<25000UL>>();
+}
+
+seastar::future<> power_of_two_cost() {
+    return placement_cost<ultramarine::impl::power_of_two_placement_strategy>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(identity_sequential),
+            ULTRAMARINE_BENCH(mixed_sequential),
+            ULTRAMARINE_BENCH(identity_strided),
+            ULTRAMARINE_BENCH(mixed_strided),
+            ULTRAMARINE_BENCH(identity_zipfian),
+            ULTRAMARINE_BENCH(mixed_zipfian),
+            ULTRAMARINE_BENCH(round_robin_cost),
+            ULTRAMARINE_BENCH(jump_consistent_hash_cost),
+            ULTRAMARINE_BENCH(rendezvous_cost),
+            ULTRAMARINE_BENCH(contiguous_cost),
+            ULTRAMARINE_BENCH(power_of_two_cost),
+    }, 10);
+}
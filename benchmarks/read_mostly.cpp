@@ -0,0 +1,104 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <boost/range/irange.hpp>
+#include <seastar/core/sleep.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include <ultramarine/utility.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t MessageCount = 2000;
+static constexpr std::size_t Concurrency = 256;
+static constexpr std::size_t WritePeriod = 20;
+static constexpr std::chrono::microseconds AccessLatency(100);
+
+// Every access waits on a simulated backing store, like a catalog refreshing its entries
+class exclusive_catalog : public ultramarine::actor<exclusive_catalog>,
+                          public ultramarine::non_reentrant_actor<exclusive_catalog> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(exclusive_catalog, (lookup)(update));
+    int version = 0;
+
+    seastar::future<int> lookup() const {
+        return seastar::sleep(AccessLatency).then([this] {
+            return version;
+        });
+    }
+
+    seastar::future<> update() {
+        return seastar::sleep(AccessLatency).then([this] {
+            ++version;
+        });
+    }
+};
+
+class shared_catalog : public ultramarine::actor<shared_catalog>,
+                       public ultramarine::reader_writer_actor<shared_catalog> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(shared_catalog, (lookup)(update));
+    int version = 0;
+
+    seastar::future<int> lookup() const {
+        return seastar::sleep(AccessLatency).then([this] {
+            return version;
+        });
+    }
+
+    seastar::future<> update() {
+        return seastar::sleep(AccessLatency).then([this] {
+            ++version;
+        });
+    }
+};
+
+// One message in WritePeriod mutates the catalog, the others only read it
+template<typename Catalog>
+seastar::future<> read_mostly() {
+    return ultramarine::with_buffer(Concurrency, [](auto &buffer) {
+        return seastar::do_for_each(boost::irange<std::size_t>(0, MessageCount), [&buffer](auto i) {
+            auto catalog = ultramarine::get<Catalog>(0);
+            if (i % WritePeriod) {
+                return buffer(catalog->lookup().discard_result());
+            }
+            return buffer(catalog->update());
+        });
+    });
+}
+
+seastar::future<> non_reentrant_read_mostly() {
+    return read_mostly<exclusive_catalog>();
+}
+
+seastar::future<> reader_writer_read_mostly() {
+    return read_mostly<shared_catalog>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(non_reentrant_read_mostly),
+            ULTRAMARINE_BENCH(reader_writer_read_mostly),
+    }, 10);
+}
@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <boost/range/irange.hpp>
+#include <seastar/core/future-util.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t ProbeCount = 2000;
+static constexpr std::size_t LoadPerShard = 16;
+static constexpr std::size_t LoadChunks = 2000;
+static constexpr std::size_t ChunkWork = 20000;
+static constexpr std::size_t PingWork = 100;
+
+std::size_t spin(std::size_t work) {
+    static thread_local volatile std::size_t sink;
+    std::size_t seed = work;
+    for (std::size_t i = 0; i < work; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return sink = seed;
+}
+
+seastar::future<> crunch() {
+    return seastar::do_for_each(boost::irange<std::size_t>(0, LoadChunks), [](auto) {
+        spin(ChunkWork);
+        return seastar::later();
+    });
+}
+
+struct latency_group {
+    static constexpr char const *name = "latency";
+    static constexpr float shares = 1000;
+};
+
+struct throughput_group {
+    static constexpr char const *name = "throughput";
+    static constexpr float shares = 100;
+};
+
+class latency_actor : public ultramarine::actor<latency_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(latency_actor, (ping));
+
+    void ping() const {
+        spin(PingWork);
+    }
+};
+
+class throughput_actor : public ultramarine::actor<throughput_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(throughput_actor, (crunch));
+
+    seastar::future<> crunch() const {
+        return ::crunch();
+    }
+};
+
+class grouped_latency_actor : public ultramarine::actor<grouped_latency_actor>,
+                              public ultramarine::scheduling_group_actor<grouped_latency_actor, latency_group> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(grouped_latency_actor, (ping));
+
+    void ping() const {
+        spin(PingWork);
+    }
+};
+
+class grouped_throughput_actor : public ultramarine::actor<grouped_throughput_actor>,
+                                 public ultramarine::scheduling_group_actor<grouped_throughput_actor,
+                                         throughput_group> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(grouped_throughput_actor, (crunch));
+
+    seastar::future<> crunch() const {
+        return ::crunch();
+    }
+};
+
+seastar::future<> create_groups() {
+    static bool created = false;
+    if (created) {
+        return seastar::make_ready_future();
+    }
+    created = true;
+    return ultramarine::create_scheduling_group<latency_group>().then([] {
+        return ultramarine::create_scheduling_group<throughput_group>();
+    });
+}
+
+// Throughput actors keep every shard busy while one latency actor is pinged in a loop. Latency percentiles are those
+// of the first run, measured from the send of the ping to its reply.
+template<typename Latency, typename Throughput>
+seastar::future<> latency_under_load() {
+    static bool reported = false;
+    return create_groups().then([] {
+        return seastar::do_with(std::vector<std::chrono::steady_clock::duration>(), [](auto &latencies) {
+            latencies.reserve(ProbeCount);
+            auto load = seastar::parallel_for_each(boost::irange<std::size_t>(0, LoadPerShard * seastar::smp::count),
+                                                   [](auto i) {
+                return ultramarine::get<Throughput>(i)->crunch();
+            });
+            auto probes = seastar::do_for_each(boost::irange<std::size_t>(0, ProbeCount), [&latencies](auto) {
+                auto start = std::chrono::steady_clock::now();
+                return ultramarine::get<Latency>(0)->ping().then([&latencies, start] {
+                    latencies.emplace_back(std::chrono::steady_clock::now() - start);
+                });
+            });
+            return seastar::when_all_succeed(std::move(load), std::move(probes)).then([&latencies] {
+                if (reported) {
+                    return;
+                }
+                reported = true;
+                std::sort(std::begin(latencies), std::end(latencies));
+                auto percentile = [&latencies](double p) {
+                    auto index = std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()));
+                    return std::chrono::duration_cast<std::chrono::microseconds>(latencies[index]).count();
+                };
+                seastar::print("\tp50          : %dus\n", percentile(0.5));
+                seastar::print("\tp99          : %dus\n", percentile(0.99));
+                seastar::print("\tp999         : %dus\n", percentile(0.999));
+            });
+        });
+    });
+}
+
+seastar::future<> default_group() {
+    return latency_under_load<latency_actor, throughput_actor>();
+}
+
+seastar::future<> separate_groups() {
+    return latency_under_load<grouped_latency_actor, grouped_throughput_actor>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(default_group),
+            ULTRAMARINE_BENCH(separate_groups),
+    }, 10);
+}
@@ -0,0 +1,145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <boost/range/irange.hpp>
+#include <seastar/core/future-util.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include <ultramarine/utility.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t PingCount = 10000;
+static constexpr std::size_t JobCount = 20000;
+static constexpr std::size_t JobWork = 50000;
+
+struct latency_shards;
+struct compute_shards;
+
+std::size_t spin(std::size_t work) {
+    static thread_local volatile std::size_t sink;
+    std::size_t seed = work;
+    for (std::size_t i = 0; i < work; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return sink = seed;
+}
+
+class shared_pong_actor : public ultramarine::actor<shared_pong_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(shared_pong_actor, (pong));
+
+    void pong() const {}
+};
+
+class shared_compute_worker : public ultramarine::actor<shared_compute_worker>,
+                              public ultramarine::local_actor<shared_compute_worker> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(shared_compute_worker, (job));
+
+    void job() const {
+        spin(JobWork);
+    }
+};
+
+class isolated_pong_actor : public ultramarine::actor<isolated_pong_actor>,
+                            public ultramarine::shard_set_actor<isolated_pong_actor,
+                                    ultramarine::shard_set<latency_shards>> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(isolated_pong_actor, (pong));
+
+    void pong() const {}
+};
+
+class isolated_compute_worker : public ultramarine::actor<isolated_compute_worker>,
+                                public ultramarine::local_actor<isolated_compute_worker>,
+                                public ultramarine::shard_set_actor<isolated_compute_worker,
+                                        ultramarine::shard_set<compute_shards>> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(isolated_compute_worker, (job));
+
+    void job() const {
+        spin(JobWork);
+    }
+};
+
+// The first shard serves latency-sensitive actors, the others run the CPU-bound jobs
+void assign_shard_sets() {
+    std::vector<seastar::shard_id> compute;
+    for (seastar::shard_id shard = 1; shard < seastar::smp::count; ++shard) {
+        compute.push_back(shard);
+    }
+    ultramarine::assign_shards<latency_shards>({0});
+    ultramarine::assign_shards<compute_shards>(compute);
+}
+
+// Ping-pong round trips, sent while the CPU-bound jobs run. Latency percentiles are those of the first run.
+template<typename Pong, typename Worker>
+seastar::future<> ping_under_load() {
+    static bool reported = false;
+    assign_shard_sets();
+    auto compute = ultramarine::with_buffer(seastar::smp::count * 4, [](auto &buffer) {
+        return seastar::do_for_each(boost::irange<std::size_t>(0, JobCount), [&buffer](auto) {
+            return buffer(ultramarine::get<Worker>(0)->job());
+        });
+    });
+    auto ping = seastar::do_with(std::vector<std::chrono::steady_clock::duration>(), [](auto &latencies) {
+        return seastar::do_for_each(boost::irange<std::size_t>(0, PingCount), [&latencies](auto i) {
+            auto start = std::chrono::steady_clock::now();
+            return ultramarine::get<Pong>(i)->pong().then([&latencies, start] {
+                latencies.emplace_back(std::chrono::steady_clock::now() - start);
+            });
+        }).then([&latencies] {
+            if (reported) {
+                return;
+            }
+            reported = true;
+            std::sort(std::begin(latencies), std::end(latencies));
+            auto percentile = [&latencies](double p) {
+                auto index = std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()));
+                return std::chrono::duration_cast<std::chrono::microseconds>(latencies[index]).count();
+            };
+            seastar::print("\tping p50     : %dus\n", percentile(0.5));
+            seastar::print("\tping p99     : %dus\n", percentile(0.99));
+        });
+    });
+    return seastar::when_all_succeed(std::move(compute), std::move(ping)).discard_result();
+}
+
+seastar::future<> shared_shards() {
+    return ping_under_load<shared_pong_actor, shared_compute_worker>();
+}
+
+seastar::future<> isolated_shards() {
+    return ping_under_load<isolated_pong_actor, isolated_compute_worker>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(shared_shards),
+            ULTRAMARINE_BENCH(isolated_shards),
+    }, 10);
+}
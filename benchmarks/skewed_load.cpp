@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <boost/range/irange.hpp>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include <ultramarine/utility.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t MessageCount = 100000;
+static constexpr std::size_t ActorCount = 64;
+static constexpr std::size_t WorkPerMessage = 2000;
+
+// Every key is a multiple of the shard count, so the identity hasher places every activation on shard 0
+ultramarine::actor_id hot_key(std::size_t i) {
+    return (i % ActorCount) * seastar::smp::count;
+}
+
+std::size_t spin(std::size_t seed) {
+    for (std::size_t i = 0; i < WorkPerMessage; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return seed;
+}
+
+class skewed_actor : public ultramarine::actor<skewed_actor> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(skewed_actor, (work));
+    std::size_t state = 0;
+
+    void work() {
+        state = spin(state);
+    }
+};
+
+class rebalanced_actor : public ultramarine::actor<rebalanced_actor>,
+                         public ultramarine::migratable_actor<rebalanced_actor> {
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(rebalanced_actor, (work));
+    std::size_t state = 0;
+
+    void work() {
+        state = spin(state);
+    }
+
+    std::size_t export_state() const {
+        return state;
+    }
+
+    void import_state(std::size_t imported) {
+        state = imported;
+    }
+};
+
+template<typename Actor>
+seastar::future<> send_work() {
+    return ultramarine::with_buffer(100, [](auto &buffer) {
+        return seastar::do_for_each(boost::irange<std::size_t>(0, MessageCount), [&buffer](auto i) {
+            return buffer(ultramarine::get<Actor>(hot_key(i))->work());
+        });
+    });
+}
+
+seastar::future<> skewed() {
+    return send_work<skewed_actor>();
+}
+
+// The first iteration runs with every activation on shard 0. Each following one runs on the placement computed by
+// the rebalancing pass that ended the previous iteration.
+seastar::future<> rebalanced() {
+    return send_work<rebalanced_actor>().then([] {
+        return ultramarine::rebalance<rebalanced_actor>().discard_result();
+    });
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(skewed),
+            ULTRAMARINE_BENCH(rebalanced),
+    }, 10);
+}
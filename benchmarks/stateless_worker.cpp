@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <boost/range/irange.hpp>
+#include <seastar/core/sleep.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t JobCount = 2000;
+
+// Same job as apps/stateless_worker, shortened: the worker waits on I/O for 1ms
+seastar::future<> simulated_job() {
+    return seastar::sleep(std::chrono::milliseconds(1));
+}
+
+class worker : public ultramarine::actor<worker>,
+               public ultramarine::local_actor<worker>,
+               public ultramarine::non_reentrant_actor<worker> {
+ULTRAMARINE_DEFINE_ACTOR(worker, (say_hello));
+
+    seastar::future<> say_hello() const {
+        return simulated_job();
+    }
+};
+
+class pooled_worker : public ultramarine::actor<pooled_worker>,
+                      public ultramarine::local_actor<pooled_worker>,
+                      public ultramarine::non_reentrant_actor<pooled_worker>,
+                      public ultramarine::pooled_actor<pooled_worker, 1, 64> {
+ULTRAMARINE_DEFINE_ACTOR(pooled_worker, (say_hello));
+
+    seastar::future<> say_hello() const {
+        return simulated_job();
+    }
+};
+
+// A burst of JobCount jobs sent at once. Without a pool, each shard runs one job at a time.
+template<typename Worker>
+seastar::future<> burst() {
+    return seastar::parallel_for_each(boost::irange<std::size_t>(0, JobCount), [](auto) {
+        return ultramarine::get<Worker>(0)->say_hello();
+    });
+}
+
+seastar::future<> single_activation() {
+    return burst<worker>();
+}
+
+seastar::future<> elastic_pool() {
+    return burst<pooled_worker>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(single_activation),
+            ULTRAMARINE_BENCH(elastic_pool),
+    }, 10);
+}
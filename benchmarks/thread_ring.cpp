@@ -31,16 +31,13 @@
 static constexpr std::size_t RingSize = 1000000;
 static constexpr std::size_t MessageCount = 1000000;
 
-template<std::size_t MaxContiguousSegmentPerShard>
-struct contiguous_placement_strategy {
-    seastar::shard_id operator()(std::size_t hash) const noexcept {
-        return (std::size_t)(hash * (seastar::smp::count / (double)MaxContiguousSegmentPerShard)) % seastar::smp::count;
-    }
-};
+using contiguous_placement_strategy = ultramarine::impl::contiguous_placement_strategy<25000UL>;
 
-class thread_ring_actor : public ultramarine::actor<thread_ring_actor, contiguous_placement_strategy<25000UL>> {
+class thread_ring_actor : public ultramarine::actor<thread_ring_actor, contiguous_placement_strategy> {
 
 public:
+    using Hasher = ultramarine::identity_key_hasher;
+
 ULTRAMARINE_DEFINE_ACTOR(thread_ring_actor, (ping));
     ultramarine::actor_id next = (key + 1) % RingSize;
 
@@ -52,14 +49,62 @@ ULTRAMARINE_DEFINE_ACTOR(thread_ring_actor, (ping));
     }
 };
 
+class direct_thread_ring_actor : public ultramarine::actor<direct_thread_ring_actor,
+        contiguous_placement_strategy>, public ultramarine::direct_dispatch_actor<direct_thread_ring_actor> {
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(direct_thread_ring_actor, (ping));
+    ultramarine::actor_id next = (key + 1) % RingSize;
+
+    seastar::future<> ping(int remaining) {
+        if (remaining > 0) {
+            return ultramarine::get<direct_thread_ring_actor>(next)->ping(remaining - 1);
+        }
+        return seastar::make_ready_future();
+    }
+};
+
+class forwarding_thread_ring_actor : public ultramarine::actor<forwarding_thread_ring_actor,
+        contiguous_placement_strategy> {
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+ULTRAMARINE_DEFINE_ACTOR(forwarding_thread_ring_actor, (ping));
+    ultramarine::actor_id next = (key + 1) % RingSize;
+
+    seastar::future<> ping(int remaining) {
+        if (remaining > 0) {
+            return ultramarine::get<forwarding_thread_ring_actor>(next).forward(message::ping(), remaining - 1);
+        }
+        return seastar::make_ready_future();
+    }
+};
+
 seastar::future<> thread_ring() {
     return thread_ring_actor::clear_directory().then([] {
         return ultramarine::get<thread_ring_actor>(0)->ping(MessageCount);
     });
 }
 
+seastar::future<> direct_thread_ring() {
+    return direct_thread_ring_actor::clear_directory().then([] {
+        return ultramarine::get<direct_thread_ring_actor>(0)->ping(MessageCount);
+    });
+}
+
+seastar::future<> forwarding_thread_ring() {
+    return forwarding_thread_ring_actor::clear_directory().then([] {
+        return ultramarine::get<forwarding_thread_ring_actor>(0)->ping(MessageCount);
+    });
+}
+
 int main(int ac, char **av) {
     return ultramarine::benchmark::run(ac, av, {
-            ULTRAMARINE_BENCH(thread_ring)
+            ULTRAMARINE_BENCH(thread_ring),
+            ULTRAMARINE_BENCH(direct_thread_ring),
+            ULTRAMARINE_BENCH(forwarding_thread_ring)
     }, 10);
 }
\ No newline at end of file
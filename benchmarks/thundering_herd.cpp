@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <chrono>
+#include <boost/range/irange.hpp>
+#include <seastar/core/sleep.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t CallerCount = 1000;
+static constexpr std::size_t HotKeyCount = 4;
+static constexpr std::chrono::microseconds LookupLatency(200);
+
+// Every lookup waits on a simulated backing store
+class catalog_actor : public ultramarine::actor<catalog_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(catalog_actor, (lookup));
+
+    seastar::future<int> lookup(int entry) const {
+        return seastar::sleep(LookupLatency).then([entry] {
+            return entry;
+        });
+    }
+};
+
+class single_flight_catalog_actor : public ultramarine::actor<single_flight_catalog_actor>,
+                                    public ultramarine::single_flight_actor<single_flight_catalog_actor> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(single_flight_catalog_actor, (lookup));
+
+    seastar::future<int> lookup(int entry) const {
+        return seastar::sleep(LookupLatency).then([entry] {
+            return entry;
+        });
+    }
+};
+
+// Every caller asks the same catalog for one of a few hot entries at once
+template<typename Catalog>
+seastar::future<> thundering_herd() {
+    return seastar::parallel_for_each(boost::irange<std::size_t>(0, CallerCount), [](auto i) {
+        return ultramarine::get<Catalog>(0)->lookup(static_cast<int>(i % HotKeyCount)).discard_result();
+    });
+}
+
+seastar::future<> herd() {
+    return thundering_herd<catalog_actor>();
+}
+
+seastar::future<> single_flight_herd() {
+    return thundering_herd<single_flight_catalog_actor>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(herd),
+            ULTRAMARINE_BENCH(single_flight_herd),
+    }, 100);
+}
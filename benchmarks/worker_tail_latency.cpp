@@ -0,0 +1,115 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <boost/range/irange.hpp>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include <ultramarine/utility.hpp>
+#include "benchmark_utility.hpp"
+
+static constexpr std::size_t JobCount = 20000;
+static constexpr std::size_t Concurrency = 64;
+static constexpr std::size_t LongJobPeriod = 20;
+static constexpr std::size_t ShortJobWork = 1000;
+static constexpr std::size_t LongJobWork = 200000;
+
+std::size_t spin(std::size_t work) {
+    static thread_local volatile std::size_t sink;
+    std::size_t seed = work;
+    for (std::size_t i = 0; i < work; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return sink = seed;
+}
+
+class round_robin_worker : public ultramarine::actor<round_robin_worker>,
+                           public ultramarine::local_actor<round_robin_worker> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(round_robin_worker, (job));
+
+    void job(std::size_t work) const {
+        spin(work);
+    }
+};
+
+class least_loaded_worker : public ultramarine::actor<least_loaded_worker>,
+                            public ultramarine::local_actor<least_loaded_worker, std::numeric_limits<std::size_t>::max(),
+                                    ultramarine::impl::least_loaded_shard_selection> {
+public:
+ULTRAMARINE_DEFINE_ACTOR(least_loaded_worker, (job));
+
+    void job(std::size_t work) const {
+        spin(work);
+    }
+};
+
+// One job in LongJobPeriod is two hundred times longer than the others. Latency percentiles are those of the
+// first run, measured from the send of the job to its reply.
+template<typename Worker>
+seastar::future<> mixed_jobs() {
+    static bool reported = false;
+    return seastar::do_with(std::vector<std::chrono::steady_clock::duration>(), [](auto &latencies) {
+        latencies.reserve(JobCount);
+        return ultramarine::with_buffer(Concurrency, [&latencies](auto &buffer) {
+            return seastar::do_for_each(boost::irange<std::size_t>(0, JobCount), [&buffer, &latencies](auto i) {
+                auto work = i % LongJobPeriod ? ShortJobWork : LongJobWork;
+                auto start = std::chrono::steady_clock::now();
+                return buffer(ultramarine::get<Worker>(0)->job(work).then([&latencies, start] {
+                    latencies.emplace_back(std::chrono::steady_clock::now() - start);
+                }));
+            });
+        }).then([&latencies] {
+            if (reported) {
+                return;
+            }
+            reported = true;
+            std::sort(std::begin(latencies), std::end(latencies));
+            auto percentile = [&latencies](double p) {
+                auto index = std::min(latencies.size() - 1, static_cast<std::size_t>(p * latencies.size()));
+                return std::chrono::duration_cast<std::chrono::microseconds>(latencies[index]).count();
+            };
+            seastar::print("\tp50          : %dus\n", percentile(0.5));
+            seastar::print("\tp99          : %dus\n", percentile(0.99));
+            seastar::print("\tp999         : %dus\n", percentile(0.999));
+        });
+    });
+}
+
+seastar::future<> round_robin() {
+    return mixed_jobs<round_robin_worker>();
+}
+
+seastar::future<> least_loaded() {
+    return mixed_jobs<least_loaded_worker>();
+}
+
+int main(int ac, char **av) {
+    return ultramarine::benchmark::run(ac, av, {
+            ULTRAMARINE_BENCH(round_robin),
+            ULTRAMARINE_BENCH(least_loaded),
+    }, 10);
+}
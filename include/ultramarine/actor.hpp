@@ -37,6 +37,7 @@ namespace ultramarine {
     /// \unique_name ultramarine::actor
     /// \tparam Derived The derived actor class for CRTP purposes
     /// \tparam LocalPlacementStrategy Optional. Allows to specify a custom local placement strategy. Defaults to [ultramarine::default_local_placement_strategy]()
+    /// A strategy is called either with the hashed key, or with the key, its hash and the shard of the caller
     /// \requires `Derived` should implement actor behavior using [ULTRAMARINE_DEFINE_ACTOR]()
     template<typename Derived, typename LocalPlacementStrategy = impl::default_local_placement_strategy>
     struct actor : private boost::noncopyable {
@@ -46,6 +47,12 @@ namespace ultramarine {
         /// See [ultramarine::actor_id]()
         using KeyType = actor_id;
 
+        /// Default key hasher, see [ultramarine::default_key_hasher]()
+        /// \unique_name ultramarine::actor::Hasher
+        /// \notes The hash of a key decides its placement, both across shards and across the nodes of a cluster.
+        /// `Derived` may shadow this alias to use another hasher, such as [ultramarine::identity_key_hasher]()
+        using Hasher = default_key_hasher;
+
         /// Default placement strategy
         using PlacementStrategy = LocalPlacementStrategy;
 
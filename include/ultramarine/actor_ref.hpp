@@ -26,6 +26,8 @@
 
 #include <any>
 #include <variant>
+#include <boost/range/irange.hpp>
+#include <seastar/core/future-util.hh>
 #include "impl/directory.hpp"
 #include "impl/actor_ref_impl.hpp"
 
@@ -44,6 +46,9 @@ namespace ultramarine {
     /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
     template<typename Actor>
     class actor_ref<Actor, ActorKind::SingletonActor> {
+        static_assert(sizeof(impl::collocated_actor_ref<Actor>) <= impl::max_collocated_actor_ref_size,
+                      "Collocated actor references must stay within three words");
+
         impl::actor_ref_variant<Actor> impl;
     public:
 
@@ -63,16 +68,11 @@ namespace ultramarine {
         /// \returns The value returned by the provided lambda, if any
         template<typename Func>
         inline constexpr auto visit(Func &&func) const noexcept {
-            return std::visit([func = std::forward<Func>(func)](auto const &impl) mutable {
-                using ret_type = std::result_of_t<Func(decltype(impl))>;
-                if constexpr (seastar::is_future<ret_type>::value) {
-                    return seastar::do_with(std::move(decltype(impl)(impl)), [func](auto const &impl) mutable {
-                        return func(impl);
-                    });
-                } else {
-                    return func(impl);
-                }
-            }, impl);
+#ifdef ULTRAMARINE_REMOTE
+            return std::visit(std::forward<Func>(func), impl);
+#else
+            return func(impl);
+#endif
         }
 
     public:
@@ -90,13 +90,40 @@ namespace ultramarine {
         /// \returns A future representing the eventually returned value by the actor, or a failed future
         template<typename Handler, typename ...Args>
         constexpr auto inline tell(Handler message, Args &&... args) const {
-            return [this, message, args = std::make_tuple(std::forward<Args>(args) ...)]() mutable {
-                return visit([message, &args](auto const &impl) mutable {
-                    return std::apply([&impl, message](auto &&... args) mutable {
-                        return impl.tell(message, std::forward<Args>(args) ...);
-                    }, std::move(args));
-                });
-            }();
+            return visit([message, &args ...](auto const &impl) mutable {
+                return impl.tell(message, std::forward<Args>(args) ...);
+            });
+        }
+
+        /// Enqueue a message to the [ultramarine::actor]() referenced by this [ultramarine::actor_ref]() instance,
+        /// without any reply
+        /// \effects Creates the [ultramarine::actor]() if it doesn't exist
+        /// \param message The message handler to enqueue
+        /// \param args Arguments to pass to the message handler
+        /// \notes The result of the handler is discarded. If it fails, the error is passed to `Actor::on_post_error`
+        /// when `Actor` declares this static member, and logged otherwise. Messages posted from one shard to the same
+        /// actor are delivered in order, but no order is kept with messages sent through `tell`.
+        template<typename Handler, typename ...Args>
+        inline void post(Handler message, Args &&... args) const {
+            visit([message, &args ...](auto const &impl) mutable {
+                impl.post(message, std::forward<Args>(args) ...);
+            });
+        }
+
+        /// Delegate the reply of the running message handler to the [ultramarine::actor]() referenced by this
+        /// [ultramarine::actor_ref]() instance
+        /// \effects Creates the [ultramarine::actor]() if it doesn't exist
+        /// \param message The message handler to enqueue
+        /// \param args Arguments to pass to the message handler
+        /// \returns A future to be returned as is by the running message handler
+        /// \notes When called from a handler that was itself reached through `forward`, the reply of the target
+        /// completes the original caller directly: no continuation is kept on this actor and the result does not
+        /// travel back through the chain. Any other use is equivalent to `tell`.
+        template<typename Handler, typename ...Args>
+        inline auto forward(Handler message, Args &&... args) const {
+            return visit([message, &args ...](auto const &impl) mutable {
+                return impl.forward(message, std::forward<Args>(args) ...);
+            });
         }
 
         template<typename Handler, typename PackedArgs>
@@ -105,6 +132,29 @@ namespace ultramarine {
                 return impl.tell_packed(message, std::forward<PackedArgs>(args));
             });
         }
+
+        /// Destroy the activation of the [ultramarine::actor]() referenced by this [ultramarine::actor_ref]() instance
+        /// \requires Type `Actor` shall inherit from attribute [ultramarine::deactivatable_actor]()
+        /// \effects Waits for the messages being processed, then runs `on_deactivate()` if `Actor` declares it
+        /// \returns A future available once the activation has been destroyed, or kept because a new message arrived
+        inline seastar::future<> deactivate() const {
+            static_assert(is_deactivatable_v<Actor>, "deactivate() requires a deactivatable_actor");
+            return visit([](auto const &impl) {
+                return impl.deactivate();
+            });
+        }
+
+        /// Move the activation of the [ultramarine::actor]() referenced by this [ultramarine::actor_ref]() instance
+        /// \requires Type `Actor` shall inherit from attribute [ultramarine::migratable_actor]()
+        /// \effects Waits for the messages being processed, then moves the state of the activation to shard `to`.
+        /// Messages sent in the meantime are delivered on `to` once the state is imported
+        /// \returns A future available once the activation is ready on shard `to`
+        inline seastar::future<> migrate(seastar::shard_id to) const {
+            static_assert(is_migratable_v<Actor>, "migrate() requires a migratable_actor");
+            return visit([to](auto const &impl) {
+                return impl.migrate(to);
+            });
+        }
     };
 
     /// A movable and copyable reference to an [ultramarine::actor]()
@@ -112,13 +162,14 @@ namespace ultramarine {
     /// \requires Type `Actor` shall inherit from [ultramarine::actor]() and from attribute [ultramarine::local_actor]()
     template<typename Actor>
     class actor_ref<Actor, ActorKind::LocalActor> {
-        impl::ActorKey<Actor> key;
+        impl::key_handle<impl::ActorKey<Actor>> key;
 
     public:
 
         using ActorType = Actor;
 
-        explicit constexpr actor_ref(impl::ActorKey<Actor> key) : key(std::move(key)) {}
+        explicit constexpr actor_ref(impl::ActorKey<Actor> key) :
+                key(std::move(key), impl::actor_directory<Actor>::hash_key(key)) {}
 
         constexpr actor_ref(actor_ref const &) = default;
 
@@ -131,18 +182,31 @@ namespace ultramarine {
         /// \returns The value returned by the provided lambda, if any
         template<typename Func>
         inline constexpr auto visit(Func &&func) const noexcept {
+            using selection = typename Actor::shard_selection;
             seastar::shard_id next = 0;
 
+            auto hosts = impl::hosting_count<Actor>();
             if constexpr (is_unlimited_concurrent_local_actor_v<Actor>) {
-                next = (Actor::round_robin_counter++ + seastar::engine().cpu_id()) % seastar::smp::count;
+                next = selection::template select<Actor>(hosts);
             } else {
-                next = (Actor::round_robin_counter++ + seastar::engine().cpu_id())
-                       % (seastar::smp::count < Actor::max_activations ? seastar::smp::count : Actor::max_activations);
+                next = selection::template select<Actor>(
+                        hosts < Actor::max_activations ? hosts : Actor::max_activations);
             }
 
-            return impl::do_with_actor_ref_impl<Actor, impl::ActorKey<Actor>>(key, next, [&func](auto const &impl) {
-                return func(impl);
-            });
+            auto dispatch = [this, next, &func] {
+                return impl::do_with_actor_ref_impl<Actor, impl::ActorKey<Actor>>(key, next, [&func](auto const &impl) {
+                    return func(impl);
+                });
+            };
+            if constexpr (selection::tracks_load && seastar::is_future<decltype(dispatch())>::value) {
+                // Posted messages have no reply to wait for, so only messages that send one back are counted
+                impl::shard_load<Actor>::acquire(next);
+                return dispatch().finally([next] {
+                    impl::shard_load<Actor>::release(next);
+                });
+            } else {
+                return dispatch();
+            }
         }
 
     public:
@@ -161,13 +225,40 @@ namespace ultramarine {
         /// \returns A future representing the eventually returned value by the actor, or a failed future
         template<typename Handler, typename ...Args>
         constexpr auto inline tell(Handler message, Args &&... args) const {
-            return [this, message, args = std::make_tuple(std::forward<Args>(args) ...)]() mutable {
-                return visit([message, &args](auto const &impl) mutable {
-                    return std::apply([&impl, message](auto &&... args) mutable {
-                        return impl.tell(message, std::forward<Args>(args) ...);
-                    }, std::move(args));
-                });
-            }();
+            return visit([message, &args ...](auto const &impl) mutable {
+                return impl.tell(message, std::forward<Args>(args) ...);
+            });
+        }
+
+        /// Enqueue a message to the [ultramarine::actor]() referenced by this [ultramarine::actor_ref]() instance,
+        /// without any reply
+        /// \effects Creates the [ultramarine::actor]() if it doesn't exist
+        /// \param message The message handler to enqueue
+        /// \param args Arguments to pass to the message handler
+        /// \notes The result of the handler is discarded. If it fails, the error is passed to `Actor::on_post_error`
+        /// when `Actor` declares this static member, and logged otherwise. Messages posted from one shard to the same
+        /// actor are delivered in order, but no order is kept with messages sent through `tell`.
+        template<typename Handler, typename ...Args>
+        inline void post(Handler message, Args &&... args) const {
+            visit([message, &args ...](auto const &impl) mutable {
+                impl.post(message, std::forward<Args>(args) ...);
+            });
+        }
+
+        /// Delegate the reply of the running message handler to the [ultramarine::actor]() referenced by this
+        /// [ultramarine::actor_ref]() instance
+        /// \effects Creates the [ultramarine::actor]() if it doesn't exist
+        /// \param message The message handler to enqueue
+        /// \param args Arguments to pass to the message handler
+        /// \returns A future to be returned as is by the running message handler
+        /// \notes When called from a handler that was itself reached through `forward`, the reply of the target
+        /// completes the original caller directly: no continuation is kept on this actor and the result does not
+        /// travel back through the chain. Any other use is equivalent to `tell`.
+        template<typename Handler, typename ...Args>
+        inline auto forward(Handler message, Args &&... args) const {
+            return visit([message, &args ...](auto const &impl) mutable {
+                return impl.forward(message, std::forward<Args>(args) ...);
+            });
         }
 
         template<typename Handler, typename PackedArgs>
@@ -176,6 +267,19 @@ namespace ultramarine {
                 return impl.tell_packed(message, std::forward<PackedArgs>(args));
             });
         }
+
+        /// Destroy the activations of the [ultramarine::actor]() referenced by this [ultramarine::actor_ref]() instance
+        /// \requires Type `Actor` shall inherit from attribute [ultramarine::deactivatable_actor]()
+        /// \effects Deactivates the local activation on every shard
+        /// \returns A future available once every activation has been processed
+        inline seastar::future<> deactivate() const {
+            static_assert(is_deactivatable_v<Actor>, "deactivate() requires a deactivatable_actor");
+            return seastar::parallel_for_each(boost::irange<seastar::shard_id>(0, seastar::smp::count), [](auto shard) {
+                return seastar::smp::submit_to(shard, [shard] {
+                    return impl::deactivation_service<Actor>::deactivate(impl::actor_directory<Actor>::hash_key(shard));
+                });
+            });
+        }
     };
 
     /// A movable and copyable type-erased reference to a virtual actor.
@@ -47,6 +47,15 @@ namespace ultramarine::cluster::impl {
             if constexpr (std::is_same_v<Ret, void>) {
                 using Sig = seastar::rpc::no_wait_type(ActorKey<Actor>, FArgs...);
                 return n.rpc->make_client<Sig>(id)(*n.client, key, std::forward<Args>(args) ...);
+            } else if constexpr (is_single_flight_v<Actor> && ultramarine::impl::is_flight_key_v<Args...>) {
+                // Identical requests in flight from this shard share one RPC
+                using Sig = Ret(ActorKey<Actor>, FArgs...);
+                using future_type = decltype(n.rpc->make_client<Sig>(id)(*n.client, key, std::forward<Args>(args) ...));
+                using flight = ultramarine::impl::single_flight<directory<Actor>, future_type, node const *,
+                        ActorKey<Actor>, std::uint32_t, std::decay_t<Args>...>;
+                return flight::join(std::make_tuple(&n, key, id, args ...), [&] {
+                    return n.rpc->make_client<Sig>(id)(*n.client, key, std::forward<Args>(args) ...);
+                });
             } else {
                 using Sig = Ret(ActorKey<Actor>, FArgs...);
                 return n.rpc->make_client<Sig>(id)(*n.client, key, std::forward<Args>(args) ...);
@@ -66,6 +75,22 @@ namespace ultramarine::cluster::impl {
             }
         }
 
+        template<typename Ret, typename Class, typename ...FArgs, typename ...Args>
+        static constexpr auto
+        post_message(node const &n, ActorKey<Actor> const &key, Ret (Class::*fptr)(FArgs...) const, uint32_t id,
+                     Args &&... args) {
+            using Sig = seastar::rpc::no_wait_type(ActorKey<Actor>, FArgs...);
+            return n.rpc->make_client<Sig>(ultramarine::impl::one_way_identity(id))(*n.client, key, std::forward<Args>(args) ...);
+        }
+
+        template<typename Ret, typename Class, typename ...FArgs, typename ...Args>
+        static constexpr auto
+        post_message(node const &n, ActorKey<Actor> const &key, Ret (Class::*fptr)(FArgs...), uint32_t id,
+                     Args &&... args) {
+            using Sig = seastar::rpc::no_wait_type(ActorKey<Actor>, FArgs...);
+            return n.rpc->make_client<Sig>(ultramarine::impl::one_way_identity(id))(*n.client, key, std::forward<Args>(args) ...);
+        }
+
         template<typename Ret, typename Class, typename ...FArgs, typename PackedArgs>
         static constexpr auto
         dispatch_packed_message(node const &n, ActorKey<Actor> const &key, Ret (Class::*fptr)(FArgs...) const,
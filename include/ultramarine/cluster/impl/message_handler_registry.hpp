@@ -26,6 +26,9 @@
 
 #include <unordered_map>
 #include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <ultramarine/actor_ref.hpp>
 #include <ultramarine/impl/arguments_vector.hpp>
@@ -44,6 +47,37 @@ namespace ultramarine::cluster::impl {
         return init_handlers;
     }
 
+    // Owner message of each RPC verb. Regular, one-way and packed identities are derived from the message identity
+    // independently, so two messages may claim the same verb.
+    inline auto &message_verbs() {
+        static std::unordered_map<uint32_t, uint32_t> verbs = {{0, 0}};
+        return verbs;
+    }
+
+    inline auto &message_verb_conflicts() {
+        static std::vector<uint32_t> conflicts;
+        return conflicts;
+    }
+
+    inline void claim_message_verbs(uint32_t message) {
+        for (auto verb : {message, ultramarine::impl::one_way_identity(message), message | (1U << 0U)}) {
+            if (auto[it, inserted] = message_verbs().emplace(verb, message); !inserted && it->second != message) {
+                message_verb_conflicts().push_back(verb);
+            }
+        }
+    }
+
+    // Registers the handlers of every remote message with proto, refusing to start if two of them share a verb
+    inline void register_message_handlers(rpc_proto &proto) {
+        if (!message_verb_conflicts().empty()) {
+            throw std::logic_error("RPC verb " + std::to_string(message_verb_conflicts().front())
+                                   + " is claimed by two actor messages");
+        }
+        for (const auto &handler : message_handler_registry()) {
+            handler.second(&proto);
+        }
+    }
+
     template<typename Actor, typename ActorKey, typename Ret, typename Class, typename ...Args, typename Handler>
     static constexpr void __attribute__ ((used))
     register_remote_endpoint(Ret (Class::*fptr)(Args...), Handler message) {
@@ -52,6 +86,13 @@ namespace ultramarine::cluster::impl {
                 return ultramarine::get<Actor>(std::forward<ActorKey>(key)).tell(message, std::forward<Args>(args)...);
             });
 
+            // one-way version
+            uint32_t post_message_id = ultramarine::impl::one_way_identity(message.value);
+            rpc->register_handler(post_message_id, [message](ActorKey key, Args... args) {
+                ultramarine::get<Actor>(std::forward<ActorKey>(key)).post(message, std::forward<Args>(args)...);
+                return seastar::rpc::no_wait;
+            });
+
             // packed version
             uint32_t packed_message_id = message.value | (1U << 0U);
             using ArgPack = ultramarine::impl::arguments_vector<std::tuple<Args...>>;
@@ -60,7 +101,11 @@ namespace ultramarine::cluster::impl {
                 return actor.tell_packed(message, std::forward<ArgPack>(args));
             });
         };
-        message_handler_registry().insert({message.value, reg});
+        if (message_handler_registry().insert({message.value, reg}).second) {
+            claim_message_verbs(message.value);
+        } else {
+            message_verb_conflicts().push_back(message.value);
+        }
     }
 
     template<typename Actor, typename ActorKey, typename Ret, typename Class, typename ...Args, typename Handler>
@@ -71,6 +116,13 @@ namespace ultramarine::cluster::impl {
                 return ultramarine::get<Actor>(std::forward<ActorKey>(key)).tell(message, std::forward<Args>(args)...);
             });
 
+            // one-way version
+            uint32_t post_message_id = ultramarine::impl::one_way_identity(message.value);
+            rpc->register_handler(post_message_id, [message](ActorKey key, Args... args) {
+                ultramarine::get<Actor>(std::forward<ActorKey>(key)).post(message, std::forward<Args>(args)...);
+                return seastar::rpc::no_wait;
+            });
+
             // packed version
             uint32_t packed_message_id = message.value | (1U << 0U);
             using ArgPack = ultramarine::impl::arguments_vector<std::tuple<Args...>>;
@@ -79,6 +131,10 @@ namespace ultramarine::cluster::impl {
                 return actor.tell_packed(message, std::forward<ArgPack>(args));
             });
         };
-        message_handler_registry().insert({message.value, reg});
+        if (message_handler_registry().insert({message.value, reg}).second) {
+            claim_message_verbs(message.value);
+        } else {
+            message_verb_conflicts().push_back(message.value);
+        }
     }
 }
\ No newline at end of file
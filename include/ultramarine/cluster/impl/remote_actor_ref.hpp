@@ -26,19 +26,22 @@
 
 #include <seastar/core/future.hh>
 #include <seastar/core/reactor.hh>
+#include <ultramarine/impl/forwarding.hpp>
+#include <ultramarine/impl/post.hpp>
+#include <ultramarine/impl/key_handle.hpp>
 #include "distributed_directory.hpp"
 
 namespace ultramarine::cluster::impl {
     template<typename Actor>
     class remote_actor_ref {
-        ultramarine::impl::ActorKey<Actor> key;
+        ultramarine::impl::key_handle<ultramarine::impl::ActorKey<Actor>> key;
         node const *loc;
 
     public:
         using ActorType = Actor;
 
-        explicit constexpr remote_actor_ref(ultramarine::impl::ActorKey<Actor> k, std::size_t hash, node const *loc) :
-                key(std::move(k)), loc(loc) {}
+        explicit constexpr remote_actor_ref(ultramarine::impl::key_handle<ultramarine::impl::ActorKey<Actor>> k,
+                                            std::size_t hash, node const *loc) : key(std::move(k)), loc(loc) {}
 
         constexpr remote_actor_ref(remote_actor_ref const &) = default;
 
@@ -50,15 +53,39 @@ namespace ultramarine::cluster::impl {
 
         template<typename Handler, typename ...Args>
         inline constexpr auto tell(Handler message, Args &&... args) const {
-            return directory<Actor>::dispatch_message(*loc, key, ultramarine::impl::vtable<Actor>::table[message],
+            return directory<Actor>::dispatch_message(*loc, key.get(), ultramarine::impl::vtable<Actor>::table[message],
                                                       message.value, std::forward<Args>(args) ...);
         }
 
+        template<typename Handler, typename ...Args>
+        inline void post(Handler message, Args &&... args) const {
+            (void) directory<Actor>::post_message(*loc, key.get(), ultramarine::impl::vtable<Actor>::table[message],
+                                                  message.value, std::forward<Args>(args) ...).handle_exception(
+                    [](std::exception_ptr ex) {
+                        ultramarine::impl::report_post_error<Actor>(std::move(ex));
+                    });
+        }
+
+        template<typename Handler, typename ...Args>
+        inline auto forward(Handler message, Args &&... args) const {
+            return ultramarine::impl::forward_result(tell(message, std::forward<Args>(args) ...));
+        }
+
         template<typename Handler, typename PackedArgs>
         constexpr auto inline tell_packed(Handler message, PackedArgs &&args) const {
-            return directory<Actor>::dispatch_packed_message(*loc, key,
+            return directory<Actor>::dispatch_packed_message(*loc, key.get(),
                                                              ultramarine::impl::vtable<Actor>::table[message],
                                                              message.value, std::forward<PackedArgs>(args));
         }
+
+        inline seastar::future<> deactivate() const {
+            return seastar::make_exception_future<>(
+                    std::logic_error("remote actors are deactivated by the node that hosts them"));
+        }
+
+        inline seastar::future<> migrate(seastar::shard_id) const {
+            return seastar::make_exception_future<>(
+                    std::logic_error("remote actors are migrated by the node that hosts them"));
+        }
     };
 }
\ No newline at end of file
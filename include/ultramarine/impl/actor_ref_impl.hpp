@@ -26,8 +26,15 @@
 
 #include <variant>
 #include <seastar/core/future.hh>
+#include <seastar/core/future-util.hh>
 #include <seastar/core/reactor.hh>
 #include "directory.hpp"
+#include "coalescer.hpp"
+#include "handoff.hpp"
+#include "forwarding.hpp"
+#include "post.hpp"
+#include "key_handle.hpp"
+#include "work_stealing.hpp"
 
 #ifdef ULTRAMARINE_REMOTE
 
@@ -36,16 +43,50 @@
 #endif
 
 namespace ultramarine::impl {
+
+    /// The number of direct dispatches that may nest on a shard before messages go through the reactor
+    static constexpr unsigned max_direct_dispatch_depth = 16;
+
+    // Counts the direct dispatches running synchronously on this shard. A handler telling another actor of its shard
+    // would otherwise recurse once per hop.
+    struct direct_dispatch_guard {
+        static inline thread_local unsigned depth = 0;
+
+        [[nodiscard]] static bool available() noexcept {
+            return depth < max_direct_dispatch_depth && !seastar::need_preempt();
+        }
+
+        direct_dispatch_guard() noexcept {
+            ++depth;
+        }
+
+        direct_dispatch_guard(direct_dispatch_guard const &) = delete;
+
+        ~direct_dispatch_guard() {
+            --depth;
+        }
+    };
+
+    // Runs task in a later reactor task, keeping it alive until its future is available
+    template<typename Task>
+    inline auto defer_task(Task &&task) {
+        return seastar::later().then([task = std::forward<Task>(task)]() mutable {
+            return seastar::do_with(std::move(task), [](auto &task) {
+                return task();
+            });
+        });
+    }
+
     template<typename Actor>
     class collocated_actor_ref {
-        ActorKey <Actor> key;
+        key_handle<ActorKey<Actor>> key;
         std::size_t hash;
         seastar::shard_id loc;
 
     public:
         using ActorType = Actor;
 
-        constexpr collocated_actor_ref(impl::ActorKey<Actor> k, std::size_t hash, seastar::shard_id loc) :
+        constexpr collocated_actor_ref(key_handle<ActorKey<Actor>> k, std::size_t hash, seastar::shard_id loc) :
                 key(std::move(k)), hash(hash), loc(loc) {}
 
         constexpr collocated_actor_ref(collocated_actor_ref const &) = default;
@@ -58,50 +99,166 @@ namespace ultramarine::impl {
 
         template<typename Handler, typename ...Args>
         inline constexpr auto tell(Handler message, Args &&... args) const {
-            return seastar::smp::submit_to(loc, [k = key, h = hash, message, args = std::make_tuple(
-                    std::forward<Args>(args) ...)]() mutable {
+            if constexpr (is_direct_dispatch_v<Actor>) {
+                if (loc == seastar::engine().cpu_id() && direct_dispatch_guard::available()) {
+                    direct_dispatch_guard guard;
+                    using ret_type = decltype(actor_directory<Actor>::dispatch_message(key.get(), hash, message,
+                                                                                      std::forward<Args>(args) ...));
+                    return seastar::futurize<ret_type>::apply([this, message](auto &&... args) {
+                        return actor_directory<Actor>::dispatch_message(key.get(), hash, message,
+                                                                        std::forward<decltype(args)>(args) ...);
+                    }, std::forward<Args>(args) ...);
+                }
+            }
+            auto task = [k = key, h = hash, message, args = make_handoff_tuple(std::forward<Args>(args) ...)]() mutable {
+                if constexpr (is_work_stealing_v<Actor>) {
+                    // A stolen message runs on the activation of the shard that dequeues it
+                    h = actor_directory<Actor>::hash_key(seastar::engine().cpu_id());
+                }
+                return std::apply([&k, h, message](auto &&... args) mutable {
+                    return actor_directory<Actor>::dispatch_message(k.get(), h, message,
+                                                                    forward_handoff<Args>(args) ...);
+                }, std::move(args));
+            };
+            if constexpr (is_direct_dispatch_v<Actor>) {
+                if (loc == seastar::engine().cpu_id()) {
+                    return defer_task(std::move(task));
+                }
+            }
+            if constexpr (is_work_stealing_v<Actor>) {
+                return work_stealing_queue<Actor>::submit(loc, std::move(task));
+            }
+            if constexpr (is_coalesced_v<Actor>) {
+                if (loc != seastar::engine().cpu_id()) {
+                    return outbound_coalescer<Actor>::submit(loc, std::move(task));
+                }
+            }
+            return seastar::smp::submit_to(loc, std::move(task));
+        }
+
+        template<typename Handler, typename ...Args>
+        inline void post(Handler message, Args &&... args) const {
+            outbound_post_queue::post(loc, [k = key, h = hash, message,
+                    args = make_handoff_tuple(std::forward<Args>(args) ...)]() mutable {
                 return std::apply([&k, h, message](auto &&... args) mutable {
-                    return actor_directory<Actor>::dispatch_message(std::move(k), h, message,
-                                                                    std::forward<Args>(args) ...);
+                    return run_posted<Actor>([&] {
+                        return actor_directory<Actor>::dispatch_message(k.get(), h, message,
+                                                                        forward_handoff<Args>(args) ...);
+                    });
                 }, std::move(args));
             });
         }
 
+        template<typename Handler, typename ...Args>
+        inline auto forward(Handler message, Args &&... args) const {
+            using future_type = decltype(tell(message, std::forward<Args>(args) ...));
+            if (can_forward_reply<future_type>()) {
+                forward_reply<future_type>([ref = *this, message, args = std::make_tuple(std::forward<Args>(args) ...)](
+                        reply_channel<future_type> *channel) mutable {
+                    std::apply([&ref, channel, message](auto &&... args) {
+                        ref.send_forwarded(channel, message, std::forward<decltype(args)>(args) ...);
+                    }, std::move(args));
+                });
+                return reply_channel<future_type>::forwarded();
+            }
+            auto channel = new reply_channel<future_type>();
+            auto fut = channel->promise.get_future();
+            send_forwarded(channel, message, std::forward<Args>(args) ...);
+            return fut;
+        }
+
         template<typename Handler, typename PackedArgs>
         constexpr auto inline tell_packed(Handler message, PackedArgs &&args) const {
-            return seastar::smp::submit_to(loc, [k = key, h = hash, message,
-                    args = std::forward<PackedArgs>(args)]() mutable {
-                return actor_directory<Actor>::dispatch_packed_message(std::move(k), h, message,
+            if constexpr (is_direct_dispatch_v<Actor>) {
+                if (loc == seastar::engine().cpu_id() && direct_dispatch_guard::available()) {
+                    direct_dispatch_guard guard;
+                    return actor_directory<Actor>::dispatch_packed_message(key.get(), hash, message,
+                                                                           std::forward<PackedArgs>(args));
+                }
+            }
+            auto task = [k = key, h = hash, message, args = std::forward<PackedArgs>(args)]() mutable {
+                return actor_directory<Actor>::dispatch_packed_message(k.get(), h, message,
                                                                        std::forward<PackedArgs>(args));
+            };
+            if constexpr (is_direct_dispatch_v<Actor>) {
+                if (loc == seastar::engine().cpu_id()) {
+                    return defer_task(std::move(task));
+                }
+            }
+            return seastar::smp::submit_to(loc, std::move(task));
+        }
+
+        inline seastar::future<> deactivate() const {
+            return seastar::smp::submit_to(loc, [h = hash] {
+                return deactivation_service<Actor>::deactivate(h);
             });
         }
+
+        inline seastar::future<> migrate(seastar::shard_id to) const {
+            return seastar::smp::submit_to(loc, [k = key, h = hash, to] {
+                return migration_service<Actor>::migrate(k.get(), h, to);
+            });
+        }
+
+    private:
+        // The activation settles the channel itself, so the sender keeps no continuation. Local hops go through the
+        // reactor to keep long chains from growing the stack.
+        template<typename Future, typename Handler, typename ...Args>
+        void send_forwarded(reply_channel<Future> *channel, Handler message, Args &&... args) const {
+            auto task = [k = key, h = hash, message = forwarded_message<Handler, Future>{message, channel},
+                    args = make_handoff_tuple(std::forward<Args>(args) ...)]() mutable {
+                return std::apply([&k, h, message](auto &&... args) mutable {
+                    return reply_channel<Future>::settle(message.channel, seastar::futurize_apply([&] {
+                        return actor_directory<Actor>::dispatch_message(k.get(), h, message,
+                                                                        forward_handoff<Args>(args) ...);
+                    }));
+                }, std::move(args));
+            };
+            if (loc == seastar::engine().cpu_id()) {
+                (void) defer_task(std::move(task));
+            } else {
+                (void) seastar::smp::submit_to(loc, std::move(task));
+            }
+        }
     };
 
 #ifdef ULTRAMARINE_REMOTE
+    // The variant index doesn't fit in the collocated layout, so clustered references take one more word
     template<typename Actor>
     using actor_ref_variant = std::variant<collocated_actor_ref<Actor>, cluster::impl::remote_actor_ref<Actor>>;
 #else
+    // Without remote references, an actor_ref holds its collocated implementation directly
     template<typename Actor>
-    using actor_ref_variant = std::variant<collocated_actor_ref<Actor>>;
+    using actor_ref_variant = collocated_actor_ref<Actor>;
 #endif
 
+    // Interned key handle, hash and shard: the size of a local-only reference
+    static constexpr std::size_t max_collocated_actor_ref_size = 3 * sizeof(void *);
+
     template<typename Actor, typename KeyType, typename Func>
     [[nodiscard]] constexpr auto do_with_actor_ref_impl(KeyType &&key, Func &&func) noexcept {
         auto hash = actor_directory<Actor>::hash_key(key);
-        auto shard = typename Actor::PlacementStrategy{}(hash);
+        auto shard = actor_directory<Actor>::place(key, hash);
+        if constexpr (is_migratable_v<Actor>) {
+            if (auto moved = migration_service<Actor>::route(hash)) {
+                shard = *moved;
+            }
+        }
 
 #ifdef ULTRAMARINE_REMOTE
         using namespace ultramarine::cluster::impl;
         if (auto remote = cluster::impl::directory<Actor>::hold_remote_peer(std::forward<KeyType>(key), hash); remote) {
-            return func(remote_actor_ref<Actor>(std::forward<KeyType>(key), hash, remote));
+            return func(remote_actor_ref<Actor>(key_handle<ActorKey<Actor>>(std::forward<KeyType>(key), hash), hash,
+                                                remote));
         }
 #endif
-        return func(collocated_actor_ref<Actor>(std::forward<KeyType>(key), hash, shard));
+        return func(collocated_actor_ref<Actor>(key_handle<ActorKey<Actor>>(std::forward<KeyType>(key), hash), hash,
+                                                shard));
     }
 
     template<typename Actor, typename KeyType, typename Func>
     [[nodiscard]] inline constexpr auto
-    do_with_actor_ref_impl(KeyType const &key, seastar::shard_id shard, Func &&func) noexcept {
+    do_with_actor_ref_impl(key_handle<KeyType> const &key, seastar::shard_id shard, Func &&func) noexcept {
         auto hash = actor_directory<Actor>::hash_key(shard);
         return func(collocated_actor_ref<Actor>(key, hash, shard));
     }
@@ -24,7 +24,13 @@
 
 #pragma once
 
-#include <seastar/core/semaphore.hh>
+#include <chrono>
+#include <optional>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/shared_future.hh>
+#include "mailbox.hpp"
+#include "scheduling.hpp"
+#include "shard_selection.hpp"
 
 namespace ultramarine {
 
@@ -32,6 +38,30 @@ namespace ultramarine {
     namespace impl {
         struct local_actor {
         };
+
+        struct coalesced_actor {
+        };
+
+        struct deactivatable_actor {
+        };
+
+        struct non_reentrant_actor {
+        };
+
+        struct reader_writer_actor : non_reentrant_actor {
+        };
+
+        struct migratable_actor {
+        };
+
+        struct work_stealing_actor {
+        };
+
+        struct pooled_actor {
+        };
+
+        template<typename Actor>
+        struct migration_service;
     }
 
     /// Actor attribute base class that specify that the Derived actor should be treated as a local actor
@@ -39,29 +69,267 @@ namespace ultramarine {
     /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
     /// \tparam Derived The derived [ultramarine::actor]() class for CRTP purposes
     /// \tparam ConcurrencyLimit Optional. The limit of concurrent local activations for this actor
-    template<typename Derived, std::size_t ConcurrencyLimit = std::numeric_limits<std::size_t>::max()>
+    /// \tparam ShardSelection Optional. How the shard running a message is chosen. Defaults to
+    /// `impl::round_robin_shard_selection`. `impl::least_loaded_shard_selection` picks the least busy of two shards
+    template<typename Derived, std::size_t ConcurrencyLimit = std::numeric_limits<std::size_t>::max(),
+            typename ShardSelection = impl::round_robin_shard_selection>
     struct local_actor : impl::local_actor {
         static_assert(ConcurrencyLimit > 0, "Local actor concurrency limit must be a positive integer");
 
         /// \exclude
         static constexpr std::size_t max_activations = ConcurrencyLimit;
 
+        /// \exclude
+        using shard_selection = ShardSelection;
+
         /// \exclude
         static thread_local std::size_t round_robin_counter;
     };
 
     /// \exclude
-    template<typename Derived, std::size_t ConcurrencyLimit>
-    thread_local std::size_t local_actor<Derived, ConcurrencyLimit>::round_robin_counter = 0;
+    template<typename Derived, std::size_t ConcurrencyLimit, typename ShardSelection>
+    thread_local std::size_t local_actor<Derived, ConcurrencyLimit, ShardSelection>::round_robin_counter = 0;
+
+    /// Actor attribute base class that specify that idle shards may run messages queued for the Derived local actor on
+    /// busier shards
+    /// \unique_name ultramarine::work_stealing_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]() and [ultramarine::local_actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam StealBatch Optional. The maximum number of messages taken from another shard at once
+    /// \tparam Concurrency Optional. The number of messages a shard runs concurrently. Messages above it wait in the
+    /// queue of the shard, where they can be stolen
+    /// \remarks Only shards allowed to host an activation by the concurrency limit of [ultramarine::local_actor]()
+    /// steal messages. Messages sent with `post` are not queued, and cannot be stolen.
+    template <typename Derived, std::size_t StealBatch = 16, std::size_t Concurrency = 16>
+    struct work_stealing_actor : impl::work_stealing_actor {
+        static_assert(StealBatch > 0, "Work stealing batch size must be a positive integer");
+        static_assert(Concurrency > 0, "Work stealing concurrency must be a positive integer");
+
+        /// \exclude
+        static constexpr std::size_t steal_batch_size = StealBatch;
+
+        /// \exclude
+        static constexpr std::size_t worker_concurrency = Concurrency;
+    };
+
+    /// Actor attribute base class that specify that each shard may run several activations of the Derived local actor
+    /// \unique_name ultramarine::pooled_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]() and [ultramarine::local_actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam MinActivations Optional. The number of activations a shard keeps once it hosts one
+    /// \tparam MaxActivations Optional. The number of activations a shard may host
+    /// \tparam IdleTimeout Optional. The delay in milliseconds after which an idle activation above `MinActivations`
+    /// is destroyed
+    /// \remarks A message is run by an activation with no message in flight if there is one. Otherwise a new activation
+    /// is created, up to `MaxActivations`, after which the activation with the fewest messages in flight is used.
+    /// Combined with [ultramarine::non_reentrant_actor](), each activation runs one message at a time.
+    template <typename Derived, std::size_t MinActivations = 1, std::size_t MaxActivations = 8,
+            std::size_t IdleTimeout = 1000>
+    struct pooled_actor : impl::pooled_actor {
+        static_assert(MinActivations > 0, "Activation pools must keep at least one activation");
+        static_assert(MaxActivations >= MinActivations, "Activation pool bounds are inverted");
+
+        /// \exclude
+        static constexpr std::size_t pool_min_activations = MinActivations;
+
+        /// \exclude
+        static constexpr std::size_t pool_max_activations = MaxActivations;
+
+        /// \exclude
+        static constexpr std::chrono::milliseconds pool_idle_timeout = std::chrono::milliseconds(IdleTimeout);
+    };
+
+    /// Actor attribute base class that specify that the Derived actor should only run on a subset of the shards
+    /// \unique_name ultramarine::shard_set_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam ShardSet The shards allowed to host activations, an [ultramarine::shard_set]() or an
+    /// [ultramarine::shard_range]()
+    /// \remarks The placement strategy of the actor places it among the shards of the set as if they were the only
+    /// ones. Local actors select their shards among them, and their concurrency limit counts shards of the set. Actors
+    /// of other types keep running on every shard, so pinning CPU-heavy and latency-sensitive types to disjoint sets
+    /// keeps them from sharing reactors.
+    template <typename Derived, typename ShardSet>
+    struct shard_set_actor : impl::shard_set_actor {
+        /// \exclude
+        using shard_set = ShardSet;
+    };
+
+    /// Actor attribute base class that specify that the messages of the Derived actor run in a scheduling group
+    /// \unique_name ultramarine::scheduling_group_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam Group The group type, created with [ultramarine::create_scheduling_group]()
+    /// \remarks A message may run in another group if `Derived` declares a static `scheduling_group_of` function
+    /// taking that message and returning the group type. Seastar divides the CPU time of each shard between the groups
+    /// with pending work in proportion of their shares, so a latency-sensitive actor type keeps its share of a shard
+    /// saturated by another one.
+    template <typename Derived, typename Group>
+    struct scheduling_group_actor : impl::scheduled_actor {
+        /// \exclude
+        using scheduling_group_type = Group;
+    };
 
     /// Actor attribute base class that specify that the Derived actor should be protected against reentrancy
     /// \unique_name ultramarine::non_reentrant_actor
     /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
     /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam Capacity Optional. The number of messages that can wait in the actor mailbox. Defaults to unbounded
+    /// \tparam Policy Optional. The [ultramarine::mailbox_policy]() applied when the mailbox is full
+    /// \tparam Timeout Optional. The delay in milliseconds after which a waiting message fails with
+    /// [ultramarine::mailbox_timed_out](). Defaults to zero, meaning that messages wait indefinitely
+    template <typename Derived, std::size_t Capacity = std::numeric_limits<std::size_t>::max(),
+            mailbox_policy Policy = mailbox_policy::block, std::size_t Timeout = 0>
+    struct non_reentrant_actor : impl::non_reentrant_actor {
+        static_assert(Capacity > 0, "Mailbox capacity must be a positive integer");
+
+        /// \exclude
+        impl::mailbox<Capacity, Policy, Timeout> mailbox;
+    };
+
+    /// Actor attribute base class that specify that the Derived actor should be protected against reentrancy, except
+    /// between `const` message handlers
+    /// \unique_name ultramarine::reader_writer_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam Capacity Optional. The number of messages that can wait in the actor mailbox. Defaults to unbounded
+    /// \tparam Policy Optional. The [ultramarine::mailbox_policy]() applied when the mailbox is full
+    /// \tparam Timeout Optional. The delay in milliseconds after which a waiting message fails with
+    /// [ultramarine::mailbox_timed_out](). Defaults to zero, meaning that messages wait indefinitely
+    /// \remarks Consecutive messages with `const` handlers run concurrently. Other messages run alone, as with
+    /// [ultramarine::non_reentrant_actor](). Messages start in the order they arrive, so a `const` message sent after a
+    /// waiting mutating one waits for it.
+    template <typename Derived, std::size_t Capacity = std::numeric_limits<std::size_t>::max(),
+            mailbox_policy Policy = mailbox_policy::block, std::size_t Timeout = 0>
+    struct reader_writer_actor : impl::reader_writer_actor {
+        static_assert(Capacity > 0, "Mailbox capacity must be a positive integer");
+
+        /// \exclude
+        impl::mailbox<Capacity, Policy, Timeout> mailbox;
+    };
+
+    /// Actor attribute base class that specify that messages sent to the Derived actor from its own shard should be
+    /// dispatched inline, without going through `seastar::smp::submit_to`
+    /// \unique_name ultramarine::direct_dispatch_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \remarks The handler runs within the sender's task. This favors latency over fairness between senders.
     template <typename Derived>
-    struct non_reentrant_actor {
+    struct direct_dispatch_actor {
+    };
+
+    /// Actor attribute base class that specify that messages to the Derived actor should run through one
+    /// `seastar::execution_stage` per message type
+    /// \unique_name ultramarine::staged_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \remarks Messages of the same type are queued on their shard and run back-to-back, so the handler stays hot
+    /// in the instruction cache and branch predictors. Each message waits for the next batch, even when sent from the
+    /// shard of the activation. This favors throughput over latency.
+    template <typename Derived>
+    struct staged_actor {
+    };
+
+    /// Actor attribute base class that specify that identical concurrent `const` messages to the Derived actor should
+    /// share one execution
+    /// \unique_name ultramarine::single_flight_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \remarks A message with a `const` handler returning a future, that arrives at an activation while an identical
+    /// one is in flight, completes with a copy of its result. Messages are identical if they have the same type and
+    /// equal arguments. Arguments must be hashable by [ultramarine::default_key_hasher](); messages with other
+    /// arguments always run. A node also sends a single request for identical remote messages in flight from the same
+    /// shard.
+    template <typename Derived>
+    struct single_flight_actor {
+    };
+
+    /// Actor attribute base class that specify that messages sent to the Derived actor from another shard should be
+    /// coalesced into one `seastar::smp::submit_to` per destination shard
+    /// \unique_name ultramarine::coalesced_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam BatchSize Optional. The number of messages after which a batch is sent to its destination shard
+    /// \tparam FlushDeadline Optional. The delay in microseconds after which an incomplete batch is sent anyway.
+    /// Defaults to zero, meaning that a batch is sent once the tasks currently queued on the sending shard have run
+    /// \remarks Each message completes as soon as it has been handled: replies ready at the same time on the destination
+    /// shard are sent back together, without waiting for the rest of their batch.
+    template <typename Derived, std::size_t BatchSize = 64, std::size_t FlushDeadline = 0>
+    struct coalesced_actor : impl::coalesced_actor {
+        static_assert(BatchSize > 0, "Coalescing batch size must be a positive integer");
+
+        /// \exclude
+        static constexpr std::size_t coalescing_batch_size = BatchSize;
+
         /// \exclude
-        seastar::semaphore semaphore = seastar::semaphore(1);
+        static constexpr std::chrono::microseconds coalescing_flush_deadline = std::chrono::microseconds(FlushDeadline);
+    };
+
+    /// Actor attribute base class that specify that activations of the Derived actor may be destroyed when idle
+    /// \unique_name ultramarine::deactivatable_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]()
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam IdleTimeout Optional. The delay in seconds without messages after which an activation is destroyed.
+    /// Defaults to zero, meaning that activations are only destroyed explicitly or under memory pressure
+    /// \remarks `Derived` may declare an `on_deactivate()` member, returning `void` or a future, to flush its state
+    /// before being destroyed. An activation that receives a message while `on_deactivate()` runs is kept alive.
+    /// `Derived` may also declare a `memory_usage() const` member returning the bytes it owns beyond `sizeof(Derived)`,
+    /// which then count towards the activation memory budget.
+    template <typename Derived, std::size_t IdleTimeout = 0>
+    struct deactivatable_actor : impl::deactivatable_actor {
+        /// \exclude
+        static constexpr std::chrono::seconds idle_timeout = std::chrono::seconds(IdleTimeout);
+
+        /// \exclude
+        seastar::lowres_clock::time_point last_message = seastar::lowres_clock::now();
+
+        /// \exclude
+        std::size_t generation = 0;
+
+        /// \exclude
+        std::size_t inflight = 0;
+
+        /// \exclude
+        bool referenced = true;
+
+        /// \exclude
+        std::optional<seastar::shared_promise<>> idle;
+    };
+
+    /// Actor attribute base class that specify that activations of the Derived actor may be moved to another shard
+    /// \unique_name ultramarine::migratable_actor
+    /// \requires Type `Derived` shall inherit from [ultramarine::actor]() and declare `export_state()`, returning
+    /// the state of the activation or a future of it, and `import_state(State)`, receiving it
+    /// \tparam Derived The derived actor class for CRTP purposes
+    /// \tparam RebalancePeriod Optional. The delay in milliseconds between two automatic rebalancing passes (see
+    /// [ultramarine::rebalance]()). Defaults to zero, meaning that activations are only moved explicitly
+    /// \tparam Threshold Optional. The load of the busiest shard, in percent of the average load, above which a
+    /// rebalancing pass moves activations. Load is the number of messages handled since the previous pass
+    /// \remarks An activation is moved once the messages it is processing have completed. Its state is exported on its
+    /// shard and imported into a new activation on the destination shard, before any further message is delivered.
+    /// Messages sent in the meantime, or through references created before the move, are forwarded.
+    /// A migratable actor cannot also be a [ultramarine::deactivatable_actor]() or a [ultramarine::pooled_actor]().
+    template <typename Derived, std::size_t RebalancePeriod = 0, std::size_t Threshold = 125>
+    struct migratable_actor : impl::migratable_actor {
+        static_assert(Threshold >= 100, "Rebalancing threshold must be at least 100 percent of the average load");
+
+        /// \exclude
+        static constexpr std::chrono::milliseconds rebalance_period = std::chrono::milliseconds(RebalancePeriod);
+
+        /// \exclude
+        static constexpr std::size_t rebalance_threshold = Threshold;
+
+        /// \exclude
+        std::size_t sampled_messages = 0;
+
+        /// \exclude
+        std::size_t pending_messages = 0;
+
+        /// \exclude
+        bool migrating = false;
+
+        /// \exclude
+        std::optional<seastar::shared_promise<>> drained;
     };
 
     /// Enum representing the possible kinds of [ultramarine::actor]()
@@ -88,7 +356,87 @@ namespace ultramarine {
     /// \tparam Actor The [ultramarine::actor]() type to test against
     /// \returns `true` if type `Actor` is reentrant, `false` otherwise
     template<typename Actor>
-    constexpr bool is_reentrant_v = !std::is_base_of_v<non_reentrant_actor<Actor>, Actor>;
+    constexpr bool is_reentrant_v = !std::is_base_of_v<impl::non_reentrant_actor, Actor>;
+
+    /// Compile-time trait testing if `const` messages to the [ultramarine::actor]() type may run concurrently
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` uses a reader/writer mailbox, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_reader_writer_v = std::is_base_of_v<impl::reader_writer_actor, Actor>;
+
+    /// Compile-time trait testing if same-shard messages to the [ultramarine::actor]() type are dispatched inline
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` uses direct dispatch, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_direct_dispatch_v = std::is_base_of_v<direct_dispatch_actor<Actor>, Actor>;
+
+    /// Compile-time trait testing if messages to the [ultramarine::actor]() type run through execution stages
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` uses execution stages, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_staged_v = std::is_base_of_v<staged_actor<Actor>, Actor>;
+
+    /// Compile-time trait testing if identical concurrent `const` messages to the [ultramarine::actor]() type share
+    /// one execution
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` uses single-flight messages, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_single_flight_v = std::is_base_of_v<single_flight_actor<Actor>, Actor>;
+
+    /// Compile-time trait testing if cross-shard messages to the [ultramarine::actor]() type are coalesced
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` uses message coalescing, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_coalesced_v = std::is_base_of_v<impl::coalesced_actor, Actor>;
+
+    /// Compile-time trait testing if activations of the [ultramarine::actor]() type can be deactivated
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` is deactivatable, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_deactivatable_v = std::is_base_of_v<impl::deactivatable_actor, Actor>;
+
+    /// Compile-time trait testing if activations of the [ultramarine::actor]() type can move between shards
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` is migratable, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_migratable_v = std::is_base_of_v<impl::migratable_actor, Actor>;
+
+    /// Compile-time trait testing if idle shards may steal the messages of the [ultramarine::actor]() type
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` uses work stealing, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_work_stealing_v = std::is_base_of_v<impl::work_stealing_actor, Actor>;
+
+    /// Compile-time trait testing if shards may run several activations of the [ultramarine::actor]() type
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` is pooled, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_pooled_v = std::is_base_of_v<impl::pooled_actor, Actor>;
+
+    /// Compile-time trait testing if the [ultramarine::actor]() type only runs on a subset of the shards
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \returns `true` if type `Actor` is restricted to a shard set, `false` otherwise
+    template<typename Actor>
+    constexpr bool is_shard_set_v = impl::has_shard_set_v<Actor>;
+
+    /// Compile-time trait testing if a message of the [ultramarine::actor]() type runs in a scheduling group
+    /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
+    /// \tparam Actor The [ultramarine::actor]() type to test against
+    /// \tparam Handler The message type to test against
+    /// \returns `true` if messages of type `Handler` run in a scheduling group of their own or of `Actor`, `false`
+    /// otherwise
+    template<typename Actor, typename Handler>
+    constexpr bool is_scheduled_v = impl::is_scheduled_message_v<Actor, Handler>;
 
     /// Compile-time trait testing if the [ultramarine::actor]() type is local
     /// \requires Type `Actor` shall inherit from [ultramarine::actor]()
@@ -102,5 +450,6 @@ namespace ultramarine {
     /// \tparam Actor The actor type to test against
     /// \returns `true` if `Actor` has no concurrency limit, `false` otherwise
     template<typename Actor>
-    constexpr bool is_unlimited_concurrent_local_actor_v = std::is_base_of_v<local_actor<Actor>, Actor>;
+    constexpr bool is_unlimited_concurrent_local_actor_v =
+            Actor::max_activations == std::numeric_limits<std::size_t>::max();
 }
\ No newline at end of file
@@ -0,0 +1,236 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <seastar/core/future.hh>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/sleep.hh>
+
+namespace ultramarine::impl {
+
+    // A message queued for a remote shard. dispatch() runs on the destination shard, complete() on the source shard.
+    // The future returned by dispatch() never fails: the outcome is kept in the message until complete() runs.
+    struct coalesced_message {
+        virtual ~coalesced_message() = default;
+
+        virtual seastar::future<> dispatch() noexcept = 0;
+
+        virtual void complete(std::exception_ptr const &batch_failure) noexcept = 0;
+    };
+
+    // Sends completed messages back to the shard they came from. Replies ready during the same reactor poll share a
+    // single smp::submit_to, and each message is completed as soon as its own reply arrives.
+    template<typename Actor>
+    class reply_coalescer {
+        struct reply_queue {
+            std::vector<coalesced_message *> pending;
+            bool flush_scheduled = false;
+        };
+
+        static inline thread_local std::vector<reply_queue> queues;
+
+        static void flush(seastar::shard_id source) {
+            auto &queue = queues[source];
+            if (queue.pending.empty()) {
+                return;
+            }
+
+            (void) seastar::smp::submit_to(source, [msgs = std::exchange(queue.pending, {})] {
+                for (auto msg : msgs) {
+                    msg->complete(nullptr);
+                    delete msg;
+                }
+            });
+        }
+
+    public:
+        static void reply(seastar::shard_id source, coalesced_message *msg) {
+            if (queues.empty()) {
+                queues.resize(seastar::smp::count);
+            }
+
+            auto &queue = queues[source];
+            queue.pending.push_back(msg);
+            if (queue.pending.size() >= Actor::coalescing_batch_size) {
+                flush(source);
+            } else if (!queue.flush_scheduled) {
+                queue.flush_scheduled = true;
+                (void) seastar::later().then([source] {
+                    queues[source].flush_scheduled = false;
+                    flush(source);
+                });
+            }
+        }
+    };
+
+    template<typename Func>
+    class coalesced_message_impl final : public coalesced_message {
+        using futurator = seastar::futurize<std::result_of_t<Func()>>;
+        using future_type = typename futurator::type;
+        using value_type = typename future_type::value_type;
+
+        Func func;
+        std::optional<value_type> result;
+        std::exception_ptr ex;
+        typename futurator::promise_type promise;
+
+    public:
+        explicit coalesced_message_impl(Func &&func) : func(std::move(func)) {}
+
+        future_type get_future() noexcept {
+            return promise.get_future();
+        }
+
+        seastar::future<> dispatch() noexcept override {
+            return futurator::apply(func).then_wrapped([this](future_type &&f) {
+                try {
+                    result = f.get();
+                } catch (...) {
+                    ex = std::current_exception();
+                }
+            });
+        }
+
+        void complete(std::exception_ptr const &batch_failure) noexcept override {
+            if (result) {
+                promise.set_value(std::move(*result));
+            } else {
+                promise.set_exception(ex ? ex : batch_failure);
+            }
+        }
+    };
+
+    // A message that sends no reply. Its result is discarded on the destination shard and completion is a no-op.
+    template<typename Func>
+    class posted_message_impl final : public coalesced_message {
+        Func func;
+
+    public:
+        explicit posted_message_impl(Func &&func) : func(std::move(func)) {}
+
+        seastar::future<> dispatch() noexcept override {
+            return seastar::futurize_apply(func).then_wrapped([](auto &&f) {
+                f.ignore_ready_future();
+            });
+        }
+
+        void complete(std::exception_ptr const &) noexcept override {}
+    };
+
+    // Gathers the messages sent from this shard to each destination shard and forwards them with a single
+    // smp::submit_to. A batch is flushed once it holds Actor::coalescing_batch_size messages or when
+    // Actor::coalescing_flush_deadline expires, whichever comes first. A zero deadline flushes once the tasks
+    // currently queued on the reactor have run. Messages sent from one shard to another start in order.
+    // Messages of a batch don't wait for each other: each one is replied to through the reply_coalescer as soon as
+    // it completes.
+    template<typename Actor>
+    class outbound_coalescer {
+        using batch = std::vector<std::unique_ptr<coalesced_message>>;
+
+        struct outbound_queue {
+            batch pending;
+            bool flush_scheduled = false;
+        };
+
+        static inline thread_local std::vector<outbound_queue> queues;
+
+        static void flush(seastar::shard_id dest) {
+            auto &queue = queues[dest];
+            if (queue.pending.empty()) {
+                return;
+            }
+
+            // From here on, a message is owned by whichever shard is handling it, and deleted once completed
+            auto sent = std::make_unique<std::vector<coalesced_message *>>();
+            sent->reserve(queue.pending.size());
+            for (auto &msg : queue.pending) {
+                sent->push_back(msg.release());
+            }
+            queue.pending = batch();
+            queue.pending.reserve(Actor::coalescing_batch_size);
+
+            auto source = seastar::engine().cpu_id();
+            (void) seastar::smp::submit_to(dest, [sent = sent.get(), source] {
+                for (auto msg : *sent) {
+                    (void) msg->dispatch().then([msg, source] {
+                        reply_coalescer<Actor>::reply(source, msg);
+                    });
+                }
+                sent->clear();
+            }).then_wrapped([sent = std::move(sent)](seastar::future<> &&f) {
+                // Messages are left here only if the batch never reached the destination shard
+                auto ex = f.failed() ? f.get_exception() : std::exception_ptr();
+                for (auto msg : *sent) {
+                    msg->complete(ex);
+                    delete msg;
+                }
+            });
+        }
+
+        static void schedule_flush(seastar::shard_id dest) {
+            auto deadline = Actor::coalescing_flush_deadline;
+            auto timeout = deadline.count() ? seastar::sleep(deadline) : seastar::later();
+            (void) timeout.then([dest] {
+                queues[dest].flush_scheduled = false;
+                flush(dest);
+            });
+        }
+
+        static void enqueue(seastar::shard_id dest, std::unique_ptr<coalesced_message> msg) {
+            if (queues.empty()) {
+                queues.resize(seastar::smp::count);
+            }
+
+            auto &queue = queues[dest];
+            queue.pending.emplace_back(std::move(msg));
+            if (queue.pending.size() >= Actor::coalescing_batch_size) {
+                flush(dest);
+            } else if (!queue.flush_scheduled) {
+                queue.flush_scheduled = true;
+                schedule_flush(dest);
+            }
+        }
+
+    public:
+        template<typename Func>
+        static auto submit(seastar::shard_id dest, Func &&func) {
+            auto msg = std::make_unique<coalesced_message_impl<std::decay_t<Func>>>(std::forward<Func>(func));
+            auto fut = msg->get_future();
+            enqueue(dest, std::move(msg));
+            return fut;
+        }
+
+        // Queues a message whose result nobody waits for
+        template<typename Func>
+        static void post(seastar::shard_id dest, Func &&func) {
+            enqueue(dest, std::make_unique<posted_message_impl<std::decay_t<Func>>>(std::forward<Func>(func)));
+        }
+    };
+}
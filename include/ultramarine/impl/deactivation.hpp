@@ -0,0 +1,314 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/memory.hh>
+#include <seastar/core/sleep.hh>
+#include <ultramarine/impl/actor_traits.hpp>
+
+namespace ultramarine::impl {
+
+    template<typename Actor, typename = void>
+    struct has_on_deactivate : std::false_type {
+    };
+
+    template<typename Actor>
+    struct has_on_deactivate<Actor, std::void_t<decltype(std::declval<Actor &>().on_deactivate())>>
+            : std::true_type {
+    };
+
+    template<typename Actor, typename = void>
+    struct has_memory_usage : std::false_type {
+    };
+
+    template<typename Actor>
+    struct has_memory_usage<Actor, std::void_t<decltype(std::size_t(std::declval<Actor const &>().memory_usage()))>>
+            : std::true_type {
+    };
+
+    // Bytes an eviction pass committed to free, and the part of them returned to the allocator before it returned.
+    // Activation slots are kept by their directory for reuse, so only what activations own beyond them is returned.
+    struct eviction_result {
+        std::size_t scheduled = 0;
+        std::size_t released = 0;
+
+        eviction_result &operator+=(eviction_result const &other) noexcept {
+            scheduled += other.scheduled;
+            released += other.released;
+            return *this;
+        }
+    };
+
+    // Per-shard accounting shared by every deactivatable actor type.
+    // Evicts cold activations when the shard goes over its activation budget or when seastar runs low on memory.
+    struct deactivation_registry {
+        struct evictor {
+            std::size_t (*memory_usage)();
+
+            eviction_result (*evict_cold)(std::size_t bytes);
+        };
+
+        static inline thread_local std::vector<evictor> evictors;
+        static inline thread_local std::size_t memory_budget = std::numeric_limits<std::size_t>::max();
+        static inline thread_local std::size_t next_evictor = 0;
+        static inline thread_local bool eviction_scheduled = false;
+        static inline thread_local std::unique_ptr<seastar::memory::reclaimer> reclaimer;
+
+        static std::size_t memory_usage() {
+            std::size_t usage = 0;
+            for (auto &e : evictors) {
+                usage += e.memory_usage();
+            }
+            return usage;
+        }
+
+        static eviction_result evict(std::size_t bytes) {
+            eviction_result result;
+            for (std::size_t i = 0; i < evictors.size() && result.scheduled < bytes; ++i) {
+                result += evictors[next_evictor++ % evictors.size()].evict_cold(bytes - result.scheduled);
+            }
+            return result;
+        }
+
+        // Activations whose on_deactivate() hook defers are freed later: only memory released inline counts
+        static seastar::memory::reclaiming_result reclaim() {
+            auto usage = memory_usage();
+            return evict(std::max<std::size_t>(usage / 8, 1)).released
+                   ? seastar::memory::reclaiming_result::reclaimed_something
+                   : seastar::memory::reclaiming_result::reclaimed_nothing;
+        }
+
+        static void enroll(evictor e) {
+            evictors.push_back(e);
+            if (!reclaimer) {
+                reclaimer = std::make_unique<seastar::memory::reclaimer>([] { return reclaim(); });
+            }
+        }
+
+        // Actors reporting their own memory usage are walked to measure it, so the budget is checked once for all
+        // the activations created since the reactor last ran
+        static void on_activation() {
+            if (eviction_scheduled || memory_budget == std::numeric_limits<std::size_t>::max()) {
+                return;
+            }
+            eviction_scheduled = true;
+            (void) seastar::later().then([] {
+                eviction_scheduled = false;
+                if (auto usage = memory_usage(); usage > memory_budget) {
+                    evict(usage - memory_budget);
+                }
+            });
+        }
+    };
+
+    template<typename Actor>
+    struct deactivation_service {
+        static inline thread_local bool enrolled = false;
+        static inline thread_local bool sweep_scheduled = false;
+
+        static void touch(Actor *activation) noexcept {
+            activation->last_message = seastar::lowres_clock::now();
+            activation->referenced = true;
+            ++activation->generation;
+        }
+
+        static void acquire(Actor *activation) noexcept {
+            touch(activation);
+            ++activation->inflight;
+        }
+
+        static void release(Actor *activation) noexcept {
+            if (!--activation->inflight && activation->idle) {
+                activation->idle->set_value();
+                activation->idle.reset();
+            }
+        }
+
+        static seastar::future<> wait_idle(Actor *activation) {
+            if (!activation->inflight) {
+                return seastar::make_ready_future();
+            }
+            if (!activation->idle) {
+                activation->idle.emplace();
+            }
+            return activation->idle->get_shared_future();
+        }
+
+        static void on_activation() {
+            if (!enrolled) {
+                enrolled = true;
+                deactivation_registry::enroll({&memory_usage, &evict_cold});
+            }
+            schedule_sweep();
+            deactivation_registry::on_activation();
+        }
+
+        static std::size_t memory_usage(Actor const &activation) {
+            if constexpr (has_memory_usage<Actor>::value) {
+                return sizeof(Actor) + activation.memory_usage();
+            } else {
+                return sizeof(Actor);
+            }
+        }
+
+        // The part of memory_usage() that destroying the activation gives back to the allocator
+        static std::size_t releasable_memory(Actor const &activation) {
+            if constexpr (has_memory_usage<Actor>::value) {
+                return activation.memory_usage();
+            } else {
+                return 0;
+            }
+        }
+
+        static std::size_t memory_usage() {
+            if (!Actor::directory) {
+                return 0;
+            }
+            if constexpr (has_memory_usage<Actor>::value) {
+                std::size_t usage = 0;
+                Actor::directory->for_each([&usage](std::size_t, Actor &activation) {
+                    usage += memory_usage(activation);
+                });
+                return usage;
+            } else {
+                return Actor::directory->size() * sizeof(Actor);
+            }
+        }
+
+        // Runs the on_deactivate() hook, then destroys the activation unless it received a message in the meantime
+        static seastar::future<> deactivate(std::size_t id, Actor *activation) {
+            auto generation = activation->generation;
+            auto hook = [activation] {
+                if constexpr (has_on_deactivate<Actor>::value) {
+                    return seastar::futurize_apply([activation] { return activation->on_deactivate(); });
+                } else {
+                    return seastar::make_ready_future();
+                }
+            };
+            return hook().then([id, activation, generation] {
+                if (Actor::directory && Actor::directory->find(id) == activation && !activation->inflight
+                    && activation->generation == generation) {
+                    Actor::directory->erase(id);
+                }
+            });
+        }
+
+        static seastar::future<> deactivate(std::size_t id) {
+            Actor *activation = Actor::directory ? Actor::directory->find(id) : nullptr;
+            if (!activation) {
+                return seastar::make_ready_future();
+            }
+            return wait_idle(activation).then([id, activation] {
+                if (!Actor::directory || Actor::directory->find(id) != activation) {
+                    return seastar::make_ready_future();
+                }
+                return deactivate(id, activation);
+            });
+        }
+
+        // Second-chance (CLOCK) pass: recently used activations lose their reference bit, the others are evicted
+        // from the least recently used onwards
+        static eviction_result evict_cold(std::size_t bytes) {
+            if (!Actor::directory) {
+                return {};
+            }
+            std::vector<std::pair<std::size_t, Actor *>> candidates;
+            Actor::directory->for_each([&candidates](std::size_t id, Actor &activation) {
+                if (activation.inflight) {
+                    return;
+                }
+                if (activation.referenced) {
+                    activation.referenced = false;
+                } else {
+                    candidates.emplace_back(id, &activation);
+                }
+            });
+            std::sort(std::begin(candidates), std::end(candidates), [](auto const &lhs, auto const &rhs) {
+                return lhs.second->last_message < rhs.second->last_message;
+            });
+
+            eviction_result result;
+            for (auto it = std::begin(candidates); it != std::end(candidates) && result.scheduled < bytes; ++it) {
+                auto [id, activation] = *it;
+                auto size = memory_usage(*activation);
+                auto releasable = releasable_memory(*activation);
+                (void) deactivate(id, activation).handle_exception([](std::exception_ptr) {});
+                result.scheduled += size;
+                if (!Actor::directory || Actor::directory->find(id) != activation) {
+                    result.released += releasable;
+                }
+            }
+            return result;
+        }
+
+        static void sweep_idle() {
+            if (!Actor::directory) {
+                return;
+            }
+            auto deadline = seastar::lowres_clock::now() - Actor::idle_timeout;
+            std::vector<std::pair<std::size_t, Actor *>> idle;
+            Actor::directory->for_each([&idle, deadline](std::size_t id, Actor &activation) {
+                if (!activation.inflight && activation.last_message <= deadline) {
+                    idle.emplace_back(id, &activation);
+                }
+            });
+            for (auto &[id, activation] : idle) {
+                (void) deactivate(id, activation).handle_exception([](std::exception_ptr) {});
+            }
+        }
+
+        static void schedule_sweep() {
+            if constexpr (Actor::idle_timeout.count() > 0) {
+                if (sweep_scheduled) {
+                    return;
+                }
+                sweep_scheduled = true;
+                (void) seastar::sleep<seastar::lowres_clock>(Actor::idle_timeout / 2).then([] {
+                    sweep_scheduled = false;
+                    sweep_idle();
+                    if (Actor::directory && !Actor::directory->empty()) {
+                        schedule_sweep();
+                    }
+                });
+            }
+        }
+    };
+}
+
+namespace ultramarine {
+
+    /// Set the memory budget for the activations of [ultramarine::deactivatable_actor]() types on the calling shard
+    /// \effects Cold activations are deactivated once their combined size exceeds the budget
+    /// \param bytes The budget in bytes
+    inline void set_activation_memory_budget(std::size_t bytes) noexcept {
+        impl::deactivation_registry::memory_budget = bytes;
+    }
+}
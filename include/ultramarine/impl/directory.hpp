@@ -24,9 +24,23 @@
 
 #pragma once
 
+#include <atomic>
+#include <optional>
+#include <variant>
+#include <seastar/core/execution_stage.hh>
 #include <seastar/core/reactor.hh>
 #include <ultramarine/impl/actor_traits.hpp>
 #include "arguments_vector.hpp"
+#include "flat_directory.hpp"
+#include "deactivation.hpp"
+#include "handoff.hpp"
+#include "forwarding.hpp"
+#include "key_hash.hpp"
+#include "shard_set.hpp"
+#include "numa.hpp"
+#include "migration.hpp"
+#include "pool.hpp"
+#include "single_flight.hpp"
 
 namespace ultramarine {
 
@@ -34,17 +48,271 @@ namespace ultramarine {
     /// \unique_name ultramarine::actor_id
     using actor_id = std::size_t;
 
+    /// The arguments of a packed message, as received by a batch handler (see [ULTRAMARINE_DEFINE_ACTOR]())
+    /// \unique_name ultramarine::packed_arguments
+    template<typename ...Args>
+    using packed_arguments = impl::arguments_vector<std::tuple<Args...>>;
+
     namespace impl {
         /// A round-robin placement strategy that shards actors based on the modulo of their [ultramarine::actor::KeyType]()
         /// \unique_name ultramarine::round_robin_local_placement_strategy
+        /// \notes Balance depends on the hash, cost is one division per key. Changing the shard count moves most actors.
         struct round_robin_local_placement_strategy {
+            /// \exclude
+            static seastar::shard_id place(std::size_t hash, seastar::shard_id count) noexcept {
+                return hash % count;
+            }
+
+            /// \param A hashed [ultramarine::actor::KeyType]()
+            /// \returns The location the actor should be placed in
+            seastar::shard_id operator()(std::size_t hash) const noexcept {
+                return place(hash, seastar::smp::count);
+            }
+        };
+
+        /// A placement strategy based on jump consistent hashing (Lamping & Veach)
+        /// \unique_name ultramarine::jump_consistent_hash_placement_strategy
+        /// \notes Balance is near-perfect for any hash. Cost is `O(log(seastar::smp::count))` multiplications and
+        /// divisions per key. When the shard count grows from `n` to `n + 1` between restarts, only `1 / (n + 1)` of the
+        /// actors move, all of them to the new shard.
+        struct jump_consistent_hash_placement_strategy {
+            /// \exclude
+            static seastar::shard_id place(std::size_t hash, seastar::shard_id count) noexcept {
+                std::int64_t bucket = -1, next = 0;
+                std::uint64_t key = hash;
+                while (next < static_cast<std::int64_t>(count)) {
+                    bucket = next;
+                    key = key * 2862933555777941757ULL + 1;
+                    next = static_cast<std::int64_t>((bucket + 1) * (double(1LL << 31U) / double((key >> 33U) + 1)));
+                }
+                return static_cast<seastar::shard_id>(bucket);
+            }
+
             /// \param A hashed [ultramarine::actor::KeyType]()
             /// \returns The location the actor should be placed in
             seastar::shard_id operator()(std::size_t hash) const noexcept {
-                return hash % seastar::smp::count;
+                return place(hash, seastar::smp::count);
+            }
+        };
+
+        /// A placement strategy based on rendezvous (highest random weight) hashing
+        /// \unique_name ultramarine::rendezvous_placement_strategy
+        /// \notes Each shard is scored against the key, and the best score wins. Balance is near-perfect for any hash.
+        /// Cost is `O(seastar::smp::count)` per key, which makes it the most expensive strategy on large machines.
+        /// Adding or removing any shard only moves the actors that were, or will be, placed on it.
+        struct rendezvous_placement_strategy {
+            /// \exclude
+            static seastar::shard_id place(std::size_t hash, seastar::shard_id count) noexcept {
+                seastar::shard_id best = 0;
+                std::uint64_t best_score = 0;
+                for (seastar::shard_id shard = 0; shard < count; ++shard) {
+                    auto score = hash_integer(hash ^ hash_integer(shard));
+                    if (score > best_score || shard == 0) {
+                        best = shard;
+                        best_score = score;
+                    }
+                }
+                return best;
+            }
+
+            /// \param A hashed [ultramarine::actor::KeyType]()
+            /// \returns The location the actor should be placed in
+            seastar::shard_id operator()(std::size_t hash) const noexcept {
+                return place(hash, seastar::smp::count);
+            }
+        };
+
+        /// A placement strategy that splits every window of `WindowSize` consecutive hashes into `seastar::smp::count`
+        /// contiguous ranges, one per shard
+        /// \unique_name ultramarine::contiguous_placement_strategy
+        /// \tparam WindowSize The number of consecutive hashes split across all shards
+        /// \notes Actors whose keys are close share a shard, so that messages between neighbours stay local. This only
+        /// makes sense with [ultramarine::identity_key_hasher](). Balance is exact for dense keys, cost is one
+        /// division per key.
+        template<std::size_t WindowSize>
+        struct contiguous_placement_strategy {
+            static_assert(WindowSize > 0, "Contiguous placement window must be a positive integer");
+
+            /// \exclude
+            static seastar::shard_id place(std::size_t hash, seastar::shard_id count) noexcept {
+                return static_cast<seastar::shard_id>((hash % WindowSize) * count / WindowSize);
+            }
+
+            /// \param A hashed [ultramarine::actor::KeyType]()
+            /// \returns The location the actor should be placed in
+            seastar::shard_id operator()(std::size_t hash) const noexcept {
+                return place(hash, seastar::smp::count);
+            }
+        };
+
+        /// A placement strategy that masks the low bits of the hash when the shard count is a power of two
+        /// \unique_name ultramarine::power_of_two_placement_strategy
+        /// \notes This is the cheapest strategy, one bitwise and per key, but it only looks at the low bits of the hash:
+        /// it must be used with a well-mixed hash such as [ultramarine::default_key_hasher](). When the shard count is
+        /// not a power of two, it falls back to [ultramarine::round_robin_local_placement_strategy]().
+        struct power_of_two_placement_strategy {
+            /// \exclude
+            static seastar::shard_id place(std::size_t hash, seastar::shard_id count) noexcept {
+                if ((count & (count - 1)) == 0) {
+                    return static_cast<seastar::shard_id>(hash & (count - 1));
+                }
+                return static_cast<seastar::shard_id>(hash % count);
+            }
+
+            /// \param A hashed [ultramarine::actor::KeyType]()
+            /// \returns The location the actor should be placed in
+            seastar::shard_id operator()(std::size_t hash) const noexcept {
+                return place(hash, seastar::smp::count);
+            }
+        };
+
+        /// A placement strategy that places every actor of one partition on the same shard
+        /// \unique_name ultramarine::partitioned_placement_strategy
+        /// \tparam PartitionOf A function object mapping an [ultramarine::actor::KeyType]() to its partition key
+        /// \tparam Base Optional. The placement strategy used to place partitions. Defaults to
+        /// [ultramarine::round_robin_local_placement_strategy]()
+        /// \notes Partition keys are hashed with [ultramarine::default_key_hasher](). Actor types that use the same
+        /// `Base` strategy and the same partition key are collocated, so that messages between them stay on one shard.
+        template<typename PartitionOf, typename Base = round_robin_local_placement_strategy>
+        struct partitioned_placement_strategy {
+            /// \param key The [ultramarine::actor::KeyType]() of the actor to place
+            /// \returns The location the actor should be placed in
+            template<typename Key>
+            seastar::shard_id operator()(Key const &key, std::size_t, seastar::shard_id) const noexcept {
+                return Base{}(default_key_hasher{}(PartitionOf{}(key)));
             }
         };
 
+        /// A placement strategy that places every actor on the shard of the first caller that references it
+        /// \unique_name ultramarine::first_caller_placement_strategy
+        /// \tparam Capacity Optional. The number of placements remembered, a power of two
+        /// \tparam Fallback Optional. The placement strategy used once no placement can be remembered. Defaults to
+        /// [ultramarine::round_robin_local_placement_strategy]()
+        /// \notes Placements are recorded in a lock-free table shared by all shards and are never forgotten, so that
+        /// every later caller agrees on the shard of an actor. The table takes `Capacity * 8` bytes per actor type.
+        /// Actors whose hash collides with too many recorded placements are placed by `Fallback` instead.
+        template<std::size_t Capacity = 65536, typename Fallback = round_robin_local_placement_strategy>
+        struct first_caller_placement_strategy {
+            static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Placement capacity must be a power of two");
+
+            /// \exclude
+            static constexpr std::size_t max_probes = 16;
+
+            /// \exclude
+            static constexpr std::uint64_t shard_mask = 0xFFFFU;
+
+            // Each slot holds the high bits of a hash next to the shard it was placed on, plus one
+            /// \exclude
+            static inline std::atomic<std::uint64_t> placements[Capacity];
+
+            /// \param hash A hashed [ultramarine::actor::KeyType]()
+            /// \param caller The shard referencing the actor
+            /// \returns The location the actor should be placed in
+            template<typename Key>
+            seastar::shard_id operator()(Key const &, std::size_t hash, seastar::shard_id caller) const noexcept {
+                auto const tag = static_cast<std::uint64_t>(hash) & ~shard_mask;
+                for (std::size_t probe = 0; probe < max_probes; ++probe) {
+                    auto &slot = placements[(hash + probe) & (Capacity - 1)];
+                    auto current = slot.load(std::memory_order_relaxed);
+                    if (!current && slot.compare_exchange_strong(current, tag | (caller + 1U),
+                                                                 std::memory_order_relaxed)) {
+                        return caller;
+                    }
+                    if ((current & ~shard_mask) == tag) {
+                        return static_cast<seastar::shard_id>((current & shard_mask) - 1);
+                    }
+                }
+                return Fallback{}(hash);
+            }
+        };
+
+        /// A placement strategy that places every actor of the type on the shards of one NUMA node
+        /// \unique_name ultramarine::numa_node_placement_strategy
+        /// \tparam Node Optional. The node hosting the actors, modulo the number of nodes. Defaults to the first node
+        /// \tparam Base Optional. The placement strategy used among the shards of the node. Defaults to
+        /// [ultramarine::jump_consistent_hash_placement_strategy]()
+        /// \notes Actor types placed on the same node exchange messages without crossing sockets. The topology comes
+        /// from [ultramarine::discover_numa_topology]() or [ultramarine::set_numa_topology](). Without it, this is
+        /// equivalent to `Base`.
+        template<unsigned Node = 0, typename Base = jump_consistent_hash_placement_strategy>
+        struct numa_node_placement_strategy {
+            /// \param hash A hashed [ultramarine::actor::KeyType]()
+            /// \returns The location the actor should be placed in
+            seastar::shard_id operator()(std::size_t hash) const noexcept {
+                auto node = Node % numa_topology::nodes();
+                return numa_topology::shard_at(node, Base::place(hash, numa_topology::node_size(node)));
+            }
+        };
+
+        /// A placement strategy that places every actor of one partition on the shards of one NUMA node
+        /// \unique_name ultramarine::numa_partitioned_placement_strategy
+        /// \tparam PartitionOf A function object mapping an [ultramarine::actor::KeyType]() to its partition key
+        /// \tparam Base Optional. The placement strategy used among the shards of the node. Defaults to
+        /// [ultramarine::jump_consistent_hash_placement_strategy]()
+        /// \notes Unlike [ultramarine::partitioned_placement_strategy](), a partition is spread over every shard of its
+        /// node rather than confined to one shard. Partition keys are hashed with [ultramarine::default_key_hasher]()
+        /// and assigned to nodes with jump consistent hashing.
+        template<typename PartitionOf, typename Base = jump_consistent_hash_placement_strategy>
+        struct numa_partitioned_placement_strategy {
+            /// \param key The [ultramarine::actor::KeyType]() of the actor to place
+            /// \param hash A hashed [ultramarine::actor::KeyType]()
+            /// \returns The location the actor should be placed in
+            template<typename Key>
+            seastar::shard_id operator()(Key const &key, std::size_t hash, seastar::shard_id) const noexcept {
+                auto node = jump_consistent_hash_placement_strategy::place(default_key_hasher{}(PartitionOf{}(key)),
+                                                                           numa_topology::nodes());
+                return numa_topology::shard_at(node, Base::place(hash, numa_topology::node_size(node)));
+            }
+        };
+
+        /// A placement strategy that places every actor on the NUMA node of the first caller that references it
+        /// \unique_name ultramarine::numa_affinity_placement_strategy
+        /// \tparam Capacity Optional. The number of placements remembered, a power of two
+        /// \tparam Fallback Optional. The placement strategy used once no placement can be remembered. Defaults to
+        /// [ultramarine::round_robin_local_placement_strategy]()
+        /// \notes The shard is picked by hash among the shards of the caller's node, and remembered like in
+        /// [ultramarine::first_caller_placement_strategy](), so that a single caller's actors are spread over its node.
+        template<std::size_t Capacity = 65536, typename Fallback = round_robin_local_placement_strategy>
+        struct numa_affinity_placement_strategy : first_caller_placement_strategy<Capacity, Fallback> {
+            /// \param key The [ultramarine::actor::KeyType]() of the actor to place
+            /// \param hash A hashed [ultramarine::actor::KeyType]()
+            /// \param caller The shard referencing the actor
+            /// \returns The location the actor should be placed in
+            template<typename Key>
+            seastar::shard_id operator()(Key const &key, std::size_t hash, seastar::shard_id caller) const noexcept {
+                auto node = numa_topology::node_of(caller);
+                auto shard = numa_topology::shard_at(node, jump_consistent_hash_placement_strategy::place(
+                        hash, numa_topology::node_size(node)));
+                return first_caller_placement_strategy<Capacity, Fallback>::operator()(key, hash, shard);
+            }
+        };
+
+        /// Compile-time trait testing if a placement strategy is given the key and the caller's shard
+        /// \notes Such strategies declare `seastar::shard_id operator()(Key const &key, std::size_t hash,
+        /// seastar::shard_id caller)`. They must place a given key on the same shard whatever the caller, or the actor
+        /// would get one activation per shard it is placed on.
+        /// \exclude
+        template<typename Strategy, typename Key>
+        inline constexpr bool is_affinity_placement_v = std::is_invocable_r_v<seastar::shard_id, Strategy const &,
+                Key const &, std::size_t, seastar::shard_id>;
+
+        template<typename Strategy, typename = void>
+        struct is_counted_placement : std::false_type {
+        };
+
+        template<typename Strategy>
+        struct is_counted_placement<Strategy, std::void_t<decltype(Strategy::place(std::size_t(),
+                                                                                   seastar::shard_id()))>>
+                : std::true_type {
+        };
+
+        /// Compile-time trait testing if a placement strategy can place actors among any number of shards
+        /// \notes Such strategies declare `static seastar::shard_id place(std::size_t hash, seastar::shard_id count)`.
+        /// Actors restricted to a [ultramarine::shard_set]() are placed among the shards of the set with it.
+        /// \exclude
+        template<typename Strategy>
+        inline constexpr bool is_counted_placement_v = is_counted_placement<Strategy>::value;
+
         /// Default local placement strategy uses [ultramarine::round_robin_local_placement_strategy]()
         /// \unique_name ultramarine::default_local_placement_strategy
         using default_local_placement_strategy = round_robin_local_placement_strategy;
@@ -52,7 +320,7 @@ namespace ultramarine {
         using actor_activation_id = unsigned int;
 
         template<typename Actor>
-        using directory = std::unordered_map<actor_id, Actor>;
+        using directory = flat_directory<Actor>;
 
         template<typename Actor>
         using ActorKey = typename Actor::KeyType;
@@ -60,8 +328,43 @@ namespace ultramarine {
         template<typename Actor>
         struct vtable {
             static constexpr auto table = Actor::internal::message::make_vtable();
+
+            template<typename Handler>
+            static constexpr auto batch(Handler message) {
+                return Actor::internal::message::batch_handler(message, 0);
+            }
+        };
+
+        // Tags a packed message that is delivered in one call to the batch handler paired with Handler
+        template<typename Handler>
+        struct batch_message {
+            Handler handler;
+        };
+
+        template<typename Handler>
+        struct is_batch_message : std::false_type {
+        };
+
+        template<typename Handler>
+        struct is_batch_message<batch_message<Handler>> : std::true_type {
+        };
+
+        // Handlers that can't mutate their activation. A reader/writer mailbox runs them alongside each other.
+        template<typename MemberPtr>
+        struct is_const_handler : std::false_type {
+        };
+
+        template<typename Ret, typename Class, typename ...Args>
+        struct is_const_handler<Ret (Class::*)(Args...) const> : std::true_type {
+        };
+
+        template<typename Ret, typename Class, typename ...Args>
+        struct is_const_handler<Ret (Class::*)(Args...) const noexcept> : std::true_type {
         };
 
+        template<typename MemberPtr>
+        constexpr bool is_const_handler_v = is_const_handler<std::decay_t<MemberPtr>>::value;
+
         template<typename ... T>
         struct get0_return_type {
             using type = void;
@@ -77,99 +380,382 @@ namespace ultramarine {
         };
 
 
+        /// The maximum number of messages from one packed message that can be pending at once
+        static constexpr std::size_t packed_dispatch_concurrency = 128;
+
+        // Execution stages register metrics under their name, which must be unique on a shard
+        inline thread_local std::size_t next_execution_stage_id = 0;
+
         template<typename Actor>
         struct actor_directory {
 
-            template<typename KeyType>
-            [[nodiscard]] static inline constexpr auto hash_key(KeyType const &key) noexcept {
-                return std::hash<ActorKey<Actor>>{}(key);
+            [[nodiscard]] static inline constexpr std::size_t hash_key(ActorKey<Actor> const &key) noexcept {
+                return typename Actor::Hasher{}(key);
+            }
+
+            [[nodiscard]] static inline seastar::shard_id place(ActorKey<Actor> const &key, std::size_t hash) noexcept {
+                using strategy = typename Actor::PlacementStrategy;
+                if constexpr (has_shard_set_v<Actor> && is_counted_placement_v<strategy>) {
+                    return hosting_shard<Actor>(strategy::place(hash, hosting_count<Actor>()));
+                } else if constexpr (has_shard_set_v<Actor>) {
+                    // Strategies that cannot be given the size of the set are folded into it
+                    auto shard = place_anywhere(key, hash);
+                    auto count = hosting_count<Actor>();
+                    return hosting_index<Actor>(shard) < count ? shard : hosting_shard<Actor>(shard % count);
+                } else {
+                    return place_anywhere(key, hash);
+                }
+            }
+
+            [[nodiscard]] static inline seastar::shard_id place_anywhere(ActorKey<Actor> const &key,
+                                                                         std::size_t hash) noexcept {
+                using strategy = typename Actor::PlacementStrategy;
+                if constexpr (is_affinity_placement_v<strategy, ActorKey<Actor>>) {
+                    return strategy{}(key, hash, seastar::engine().cpu_id());
+                } else {
+                    return strategy{}(hash);
+                }
             }
 
             [[nodiscard]] static inline constexpr Actor *hold_activation(ActorKey<Actor> &&key, actor_id id) {
                 if (!Actor::directory) { Actor::directory = std::make_unique<ultramarine::impl::directory<Actor>>(); }
-                auto r = std::get<0>(Actor::directory->try_emplace(id, std::forward<ActorKey<Actor>>(key)));
-                return &(std::get<1>(*r));
+                if constexpr (is_deactivatable_v<Actor>) {
+                    auto size = Actor::directory->size();
+                    auto activation = Actor::directory->try_emplace(id, std::forward<ActorKey<Actor>>(key));
+                    if (Actor::directory->size() != size) {
+                        deactivation_service<Actor>::on_activation();
+                        if constexpr (is_migratable_v<Actor>) {
+                            migration_service<Actor>::on_activation();
+                        }
+                    }
+                    return activation;
+                } else if constexpr (is_migratable_v<Actor>) {
+                    auto size = Actor::directory->size();
+                    auto activation = Actor::directory->try_emplace(id, std::forward<ActorKey<Actor>>(key));
+                    if (Actor::directory->size() != size) {
+                        migration_service<Actor>::on_activation();
+                    }
+                    return activation;
+                } else {
+                    return Actor::directory->try_emplace(id, std::forward<ActorKey<Actor>>(key));
+                }
+            }
+
+            [[nodiscard]] static inline constexpr Actor *hold_activation(ActorKey<Actor> const &key, actor_id id) {
+                if (Actor::directory) {
+                    if (auto activation = Actor::directory->find(id)) {
+                        return activation;
+                    }
+                }
+                return hold_activation(ActorKey<Actor>(key), id);
+            }
+
+            template<typename Handler>
+            static constexpr auto member_of(Handler message) {
+                if constexpr (is_batch_message<Handler>::value) {
+                    return vtable<Actor>::batch(message.handler);
+                } else if constexpr (is_forwarded_message<Handler>::value) {
+                    return vtable<Actor>::table[message.handler];
+                } else {
+                    return vtable<Actor>::table[message];
+                }
             }
 
             template<typename Handler, typename ...Args>
-            static constexpr auto dispatch_message_impl(Actor *activation, Handler message, Args &&... args) {
+            static constexpr decltype(auto) call_handler(Actor *activation, Handler message, Args &&... args) {
+                forwarding_scope scope(frame_of(message));
+                if constexpr (is_forwarded_message<Handler>::value) {
+                    return scope.release(seastar::futurize_apply([&] {
+                        return (activation->*member_of(message))(unwrap_handoff(std::forward<Args>(args)) ...);
+                    }));
+                } else {
+                    return (activation->*member_of(message))(unwrap_handoff(std::forward<Args>(args)) ...);
+                }
+            }
+
+            template<typename Handler, typename ...Args>
+            static constexpr auto invoke_message(Actor *activation, Handler message, Args &&... args) {
                 if constexpr (is_reentrant_v<Actor>) {
-                    return (activation->*vtable<Actor>::table[message])(std::forward<Args>(args) ...);
+                    return call_handler(activation, message, std::forward<Args>(args) ...);
                 } else {
-                    return seastar::with_semaphore(activation->semaphore, 1, std::chrono::seconds(1),
-                                                   [message, activation, args = std::make_tuple(
-                                                           std::forward<Args>(args) ...)]() mutable {
-                                                       return std::apply([activation, message](Args &&... args) {
-                                                           return (activation->*vtable<Actor>::table[message])(
-                                                                   std::forward<Args>(args) ...);
-                                                       }, std::move(args));
-                                                   });
+                    using ret_type = decltype(call_handler(activation, message, std::forward<Args>(args) ...));
+                    constexpr bool shared = is_reader_writer_v<Actor>
+                                            && is_const_handler_v<decltype(member_of(message))>;
+                    if (activation->mailbox.idle(shared)) {
+                        activation->mailbox.enter(shared);
+                        return activation->mailbox.leave(seastar::futurize<ret_type>::apply(
+                                [activation, message](auto &&... args) {
+                                    return call_handler(activation, message, std::forward<decltype(args)>(args) ...);
+                                }, std::forward<Args>(args) ...), shared);
+                    }
+                    return activation->mailbox.post([message, activation, args = std::make_tuple(
+                            std::forward<Args>(args) ...)]() mutable {
+                        return std::apply([activation, message](Args &&... args) {
+                            return call_handler(activation, message, std::forward<Args>(args) ...);
+                        }, std::move(args));
+                    }, shared);
                 }
             }
 
-            template<typename KeyType, typename Handler, typename ...Args>
-            static constexpr auto dispatch_message(KeyType &&key, actor_id id, Handler message, Args &&... args) {
-                return dispatch_message_impl(hold_activation(std::forward<KeyType>(key), id), message,
-                                             std::forward<Args>(args) ...);
+            // One stage per message type and argument types on each shard. Stages run their batch in the scheduling
+            // group of the message.
+            template<typename Handler, typename ...Args>
+            static auto &execution_stage_of() {
+                static thread_local auto stage = seastar::make_execution_stage(
+                        "ultramarine_" + seastar::to_sstring(handler_of<Handler>::type::value) + "_"
+                        + seastar::to_sstring(next_execution_stage_id++), scheduling_group_of<Actor, Handler>(),
+                        [](Actor *activation, Handler message, Args... args) {
+                            return invoke_message(activation, message, std::move(args) ...);
+                        });
+                return stage;
             }
 
-            template<typename ReturnType, typename KeyType, typename Handler, typename ...Args>
-            static constexpr std::enable_if_t<std::is_same_v<ReturnType, void>, seastar::future<>>
-            dispatch_packed_message(Actor *act, KeyType &&key, actor_id id, Handler message,
-                                    arguments_vector<std::tuple<Args...>> &&args) {
-                using namespace seastar;
-                using ArgTuple = std::tuple<Args...>;
-                using FuncPtr = decltype(&dispatch_message_impl<Handler, Args...>);
+            template<typename Handler, typename ...Args>
+            static constexpr auto schedule_message(Actor *activation, Handler message, Args &&... args) {
+                if constexpr (is_staged_v<Actor> && !is_batch_message<Handler>::value) {
+                    return execution_stage_of<Handler, std::decay_t<Args>...>()(activation, message,
+                                                                                std::forward<Args>(args) ...);
+                } else if constexpr (is_scheduled_v<Actor, Handler>) {
+                    return seastar::with_scheduling_group(scheduling_group_of<Actor, Handler>(),
+                                                          [activation, message](auto &&... args) {
+                        return invoke_message(activation, message, std::forward<decltype(args)>(args) ...);
+                    }, std::forward<Args>(args) ...);
+                } else {
+                    return invoke_message(activation, message, std::forward<Args>(args) ...);
+                }
+            }
+
+            // Forwarded messages each carry their own reply channel, which a joiner would never see completed
+            template<typename Handler, typename ...Args>
+            static constexpr bool is_single_flight_message() {
+                if constexpr (is_single_flight_v<Actor> && !is_batch_message<Handler>::value &&
+                              !is_forwarded_message<Handler>::value && is_flight_key_v<Args...>) {
+                    using ret_type = decltype(schedule_message(std::declval<Actor *>(), std::declval<Handler>(),
+                                                               std::declval<Args>() ...));
+                    return is_const_handler_v<decltype(member_of(std::declval<Handler>()))> &&
+                           seastar::is_future<ret_type>::value;
+                } else {
+                    return false;
+                }
+            }
 
-                return do_with(act, std::move(args), [id, message]
-                        (Actor *act, arguments_vector<ArgTuple> &targs) mutable {
-                    return parallel_for_each(targs, [act, id, message, &targs](ArgTuple &targ) {
-                        return std::apply([act, id, message](Args &&... args) mutable {
-                            return futurize<ReturnType>::template apply<FuncPtr>(&dispatch_message_impl, act, message,
-                                                                                 std::forward<Args>(args)...);
-                        }, std::move(targ));
+            template<typename Handler, typename ...Args>
+            static constexpr auto share_message(Actor *activation, Handler message, Args &&... args) {
+                if constexpr (is_single_flight_message<Handler, Args...>()) {
+                    using future_type = decltype(schedule_message(activation, message, std::forward<Args>(args) ...));
+                    using flight = single_flight<Handler, future_type, Actor const *, std::decay_t<Args>...>;
+                    return flight::join(std::make_tuple(static_cast<Actor const *>(activation), args ...), [&] {
+                        return schedule_message(activation, message, std::forward<Args>(args) ...);
                     });
-                });
+                } else {
+                    return schedule_message(activation, message, std::forward<Args>(args) ...);
+                }
             }
 
-            template<typename ReturnType, typename KeyType, typename Handler, typename ...Args>
-            static constexpr std::enable_if_t<!std::is_same_v<ReturnType, void>, seastar::future<std::vector<ReturnType>>>
-            dispatch_packed_message(Actor *act, KeyType &&key, actor_id id, Handler message,
-                                    arguments_vector<std::tuple<Args...>> &&args) {
-                using namespace seastar;
+            // The activation is pinned before anything defers the message: execution stages, scheduling groups and
+            // mailboxes only hold a pointer to it.
+            template<typename Handler, typename ...Args>
+            static constexpr auto dispatch_message_impl(Actor *activation, Handler message, Args &&... args) {
+                if constexpr (is_deactivatable_v<Actor>) {
+                    using ret_type = decltype(share_message(activation, message, std::forward<Args>(args) ...));
+                    if constexpr (seastar::is_future<ret_type>::value) {
+                        deactivation_service<Actor>::acquire(activation);
+                        return seastar::futurize<ret_type>::apply([activation, message](auto &&... args) {
+                            return share_message(activation, message, std::forward<decltype(args)>(args) ...);
+                        }, std::forward<Args>(args) ...).finally([activation] {
+                            deactivation_service<Actor>::release(activation);
+                        });
+                    } else {
+                        deactivation_service<Actor>::touch(activation);
+                        return share_message(activation, message, std::forward<Args>(args) ...);
+                    }
+                } else {
+                    return share_message(activation, message, std::forward<Args>(args) ...);
+                }
+            }
+
+            template<typename KeyType, typename Handler, typename ...Args>
+            static constexpr auto dispatch_message(KeyType &&key, actor_id id, Handler message, Args &&... args) {
+                static_assert(!(is_migratable_v<Actor> && is_pooled_v<Actor>),
+                              "An actor cannot be both a migratable_actor and a pooled_actor");
+                static_assert(!(is_migratable_v<Actor> && is_deactivatable_v<Actor>),
+                              "An actor cannot be both a migratable_actor and a deactivatable_actor");
+                if constexpr (is_migratable_v<Actor>) {
+                    return migration_service<Actor>::dispatch(std::forward<KeyType>(key), id, message,
+                                                              std::forward<Args>(args) ...);
+                } else if constexpr (is_pooled_v<Actor>) {
+                    return pool_service<Actor>::dispatch(std::forward<KeyType>(key), id, message,
+                                                         std::forward<Args>(args) ...);
+                } else {
+                    return dispatch_message_impl(hold_activation(std::forward<KeyType>(key), id), message,
+                                                 std::forward<Args>(args) ...);
+                }
+            }
+
+            // Runs the messages of an arguments_vector in order, with at most packed_dispatch_concurrency of them
+            // pending at once. Results are stored by index so they line up with the arguments.
+            template<typename ReturnType, typename Handler, typename ...Args>
+            class packed_executor {
                 using ArgTuple = std::tuple<Args...>;
+                using Arguments = arguments_vector<ArgTuple>;
+                using Iterator = decltype(std::begin(std::declval<Arguments &>()));
                 using FuncPtr = decltype(&dispatch_message_impl<Handler, Args...>);
+                static constexpr bool has_results = !std::is_same_v<ReturnType, void>;
+                using Slot = std::conditional_t<has_results, std::optional<ReturnType>, std::monostate>;
+
+                Actor *act;
+                Handler message;
+                Arguments args;
+                Iterator it;
+                std::size_t next = 0;
+                std::size_t size;
+                std::size_t pending = 0;
+                std::vector<Slot> slots;
+                std::exception_ptr ex;
+                seastar::promise<> done;
+                bool finished = false;
+                bool yielding = false;
+
+                template<typename Future>
+                void store(std::size_t index, Future &&f) noexcept {
+                    if (f.failed()) {
+                        auto e = f.get_exception();
+                        if (!ex) {
+                            ex = std::move(e);
+                        }
+                    } else if constexpr (has_results) {
+                        slots[index].emplace(std::move(f.get0()));
+                    }
+                }
+
+                void finish() noexcept {
+                    if (!finished && next == size && !pending) {
+                        finished = true;
+                        if (ex) {
+                            done.set_exception(ex);
+                        } else {
+                            done.set_value();
+                        }
+                    }
+                }
 
-                std::vector<ReturnType> ret;
-                ret.reserve(std::size(args));
-                return do_with(act, std::move(ret), std::move(args), [id, message]
-                        (Actor *act, std::vector<ReturnType> &ret, arguments_vector<ArgTuple> &targs) mutable {
-                    return parallel_for_each(targs, [act, id, message, &ret, &targs]
-                            (ArgTuple &targ) mutable {
-                        return std::apply([act, id, message, &ret](Args &&... args) mutable {
-                            auto f = futurize<ReturnType>::template apply<FuncPtr>(&dispatch_message_impl, act, message,
-                                                                                   std::forward<Args>(args)...);
-                            return f.then_wrapped([&ret](seastar::future<ReturnType> &&fut) {
-                                if (fut.failed()) { return make_exception_future(fut.get_exception()); }
-                                ret.emplace_back(std::move(fut.get0()));
-                                return make_ready_future();
+            public:
+                packed_executor(Actor *act, Handler message, Arguments &&args) :
+                        act(act), message(message), args(std::move(args)), it(std::begin(this->args)),
+                        size(std::size(this->args)) {
+                    if constexpr (has_results) {
+                        slots.resize(size);
+                    }
+                }
+
+                void run() noexcept {
+                    if (yielding) {
+                        return;
+                    }
+                    for (std::size_t chunk = 0; next < size && pending < packed_dispatch_concurrency; ++chunk) {
+                        if (chunk && seastar::need_preempt()) {
+                            yielding = true;
+                            (void) seastar::later().then([this] {
+                                yielding = false;
+                                run();
+                            });
+                            return;
+                        }
+                        auto index = next++;
+                        auto f = std::apply([this](Args &&... args) {
+                            return seastar::futurize<ReturnType>::template apply<FuncPtr>(
+                                    &dispatch_message_impl, act, message, std::forward<Args>(args)...);
+                        }, std::move(*it++));
+                        if (f.available()) {
+                            store(index, std::move(f));
+                        } else {
+                            ++pending;
+                            (void) f.then_wrapped([this, index](auto &&f) {
+                                store(index, std::move(f));
+                                --pending;
+                                run();
                             });
-                        }, std::move(targ));
-                    }).then([&ret] { return std::move(ret); });
+                        }
+                    }
+                    finish();
+                }
+
+                seastar::future<> get_future() noexcept {
+                    return done.get_future();
+                }
+
+                auto results() {
+                    if constexpr (has_results) {
+                        std::vector<ReturnType> ret;
+                        ret.reserve(size);
+                        for (auto &slot : slots) {
+                            ret.emplace_back(std::move(*slot));
+                        }
+                        return ret;
+                    }
+                }
+            };
+
+            template<typename ReturnType, typename Handler, typename ...Args>
+            static auto dispatch_packed_message(Actor *act, Handler message, arguments_vector<std::tuple<Args...>> &&args) {
+                auto executor = std::make_unique<packed_executor<ReturnType, Handler, Args...>>(act, message,
+                                                                                                std::move(args));
+                auto fut = executor->get_future();
+                executor->run();
+                return fut.then([executor = std::move(executor)] {
+                    return executor->results();
+                });
+            }
+
+            template<typename ReturnType, typename Handler, typename Arguments>
+            static auto dispatch_batch_message(Actor *act, Handler message, Arguments &&args) {
+                using BatchReturn = std::conditional_t<std::is_same_v<ReturnType, void>, void, std::vector<ReturnType>>;
+                return seastar::do_with(std::move(args), [act, message](Arguments &args) {
+                    return seastar::futurize<BatchReturn>::apply([act, message, &args] {
+                        return dispatch_message_impl(act, batch_message<Handler>{message}, std::move(args));
+                    });
                 });
             }
 
             template<typename KeyType, typename Handler, typename ...Args>
             static constexpr auto dispatch_packed_message(KeyType &&key, actor_id id, Handler message,
                                                           arguments_vector<std::tuple<Args...>> &&args) {
+                if constexpr (is_migratable_v<Actor>) {
+                    return migration_service<Actor>::dispatch_packed(std::forward<KeyType>(key), id, message,
+                                                                     std::move(args));
+                } else if constexpr (is_pooled_v<Actor>) {
+                    return pool_service<Actor>::dispatch_packed(std::forward<KeyType>(key), id, message,
+                                                                std::move(args));
+                } else {
+                    return dispatch_packed_activation(hold_activation(std::forward<KeyType>(key), id), message,
+                                                      std::move(args));
+                }
+            }
+
+            template<typename Handler, typename ...Args>
+            static constexpr auto dispatch_packed_activation(Actor *act, Handler message,
+                                                             arguments_vector<std::tuple<Args...>> &&args) {
                 using namespace seastar;
 
                 using FutReturn = futurize_t<std::result_of_t<decltype(vtable<Actor>::table[message])(Actor, Args...)>>;
                 using ReturnType = typename get0_return_type<typename FutReturn::value_type>::type;
 
-                Actor *act = hold_activation(std::forward<KeyType>(key), id);
-                return dispatch_packed_message<ReturnType>(act, std::forward<KeyType>(key), id, message,
-                                                           std::move(args));
+                auto dispatch = [act, message, &args] {
+                    if constexpr (std::is_same_v<decltype(vtable<Actor>::batch(message)), std::nullptr_t>) {
+                        return dispatch_packed_message<ReturnType>(act, message, std::move(args));
+                    } else {
+                        return dispatch_batch_message<ReturnType>(act, message, std::move(args));
+                    }
+                };
+                // The messages of the pack yield to the reactor between them
+                if constexpr (is_deactivatable_v<Actor>) {
+                    deactivation_service<Actor>::acquire(act);
+                    return seastar::futurize_apply(dispatch).finally([act] {
+                        deactivation_service<Actor>::release(act);
+                    });
+                } else {
+                    return dispatch();
+                }
             }
         };
     }
@@ -0,0 +1,331 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace ultramarine::impl {
+
+    // Open-addressing map from actor id to activation, in the style of SwissTable.
+    // Activations live in fixed-size slabs and never move, so the Actor* handed out by emplace() and find() stays
+    // valid until the activation is erased. The index only stores (id, Actor*) pairs, probed 16 control bytes at a
+    // time. Growing allocates a second index and migrates a few groups per insertion, so no single operation pays
+    // for a full rehash.
+    template<typename Actor>
+    class flat_directory {
+        static constexpr std::size_t group_width = 16;
+        static constexpr std::size_t migration_step = 2;
+        static constexpr std::size_t slab_bytes = 16 * 1024;
+        static constexpr int8_t empty_slot = -128;
+        static constexpr int8_t deleted_slot = -2;
+
+        using storage_type = std::aligned_storage_t<sizeof(Actor), alignof(Actor)>;
+        static constexpr std::size_t slab_capacity = sizeof(storage_type) < slab_bytes
+                                                     ? slab_bytes / sizeof(storage_type) : 1;
+
+        struct alignas(group_width) group {
+            int8_t ctrl[group_width];
+        };
+
+        struct entry {
+            std::size_t id;
+            Actor *activation;
+        };
+
+        struct table {
+            std::size_t group_count = 0;
+            std::size_t size = 0;
+            std::size_t tombstones = 0;
+            std::unique_ptr<group[]> groups;
+            std::unique_ptr<entry[]> entries;
+
+            table() = default;
+
+            explicit table(std::size_t count) : group_count(count), groups(new group[count]),
+                                                entries(new entry[count * group_width]) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    std::fill(std::begin(groups[i].ctrl), std::end(groups[i].ctrl), empty_slot);
+                }
+            }
+
+            [[nodiscard]] std::size_t capacity() const noexcept {
+                return group_count * group_width;
+            }
+
+            [[nodiscard]] bool needs_growth() const noexcept {
+                return (size + tombstones + 1) * 8 > capacity() * 7;
+            }
+        };
+
+        table current;
+        table previous;
+        std::size_t migrated_groups = 0;
+
+        std::vector<std::unique_ptr<storage_type[]>> slabs;
+        std::size_t slab_used = slab_capacity;
+        std::vector<Actor *> free_slots;
+
+        static inline std::size_t mix(std::size_t id) noexcept {
+            return static_cast<std::size_t>((static_cast<unsigned __int128>(id) * 0x9E3779B97F4A7C15ULL) >> 64U)
+                   ^ (id * 0x9E3779B97F4A7C15ULL);
+        }
+
+        static inline int8_t tag_of(std::size_t hash) noexcept {
+            return static_cast<int8_t>(hash & 0x7FU);
+        }
+
+        static inline uint32_t match(group const &g, int8_t value) noexcept {
+#if defined(__SSE2__)
+            auto ctrl = _mm_load_si128(reinterpret_cast<__m128i const *>(g.ctrl));
+            return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(value), ctrl)));
+#else
+            uint32_t mask = 0;
+            for (std::size_t i = 0; i < group_width; ++i) {
+                mask |= static_cast<uint32_t>(g.ctrl[i] == value) << i;
+            }
+            return mask;
+#endif
+        }
+
+        static inline uint32_t match_free(group const &g) noexcept {
+#if defined(__SSE2__)
+            // Both empty and deleted slots have their sign bit set
+            auto ctrl = _mm_load_si128(reinterpret_cast<__m128i const *>(g.ctrl));
+            return static_cast<uint32_t>(_mm_movemask_epi8(ctrl));
+#else
+            uint32_t mask = 0;
+            for (std::size_t i = 0; i < group_width; ++i) {
+                mask |= static_cast<uint32_t>(g.ctrl[i] < 0) << i;
+            }
+            return mask;
+#endif
+        }
+
+        static inline unsigned lowest_bit(uint32_t mask) noexcept {
+            return static_cast<unsigned>(__builtin_ctz(mask));
+        }
+
+        // Returns the slot index holding id, or -1
+        static std::ptrdiff_t find_in(table const &t, std::size_t id, std::size_t hash) noexcept {
+            if (!t.group_count) {
+                return -1;
+            }
+            auto const mask = t.group_count - 1;
+            auto const tag = tag_of(hash);
+            auto g = (hash >> 7U) & mask;
+            for (std::size_t probe = 0; probe < t.group_count; g = (g + ++probe) & mask) {
+                for (auto hits = match(t.groups[g], tag); hits; hits &= hits - 1) {
+                    auto slot = g * group_width + lowest_bit(hits);
+                    if (t.entries[slot].id == id) {
+                        return static_cast<std::ptrdiff_t>(slot);
+                    }
+                }
+                if (match(t.groups[g], empty_slot)) {
+                    break;
+                }
+            }
+            return -1;
+        }
+
+        static void insert_unique(table &t, std::size_t id, std::size_t hash, Actor *activation) noexcept {
+            auto const mask = t.group_count - 1;
+            auto g = (hash >> 7U) & mask;
+            for (std::size_t probe = 0;; g = (g + ++probe) & mask) {
+                if (auto free = match_free(t.groups[g]); free) {
+                    auto index = lowest_bit(free);
+                    if (t.groups[g].ctrl[index] == deleted_slot) {
+                        --t.tombstones;
+                    }
+                    t.groups[g].ctrl[index] = tag_of(hash);
+                    t.entries[g * group_width + index] = entry{id, activation};
+                    ++t.size;
+                    return;
+                }
+            }
+        }
+
+        static void erase_slot(table &t, std::size_t slot) noexcept {
+            t.groups[slot / group_width].ctrl[slot % group_width] = deleted_slot;
+            --t.size;
+            ++t.tombstones;
+        }
+
+        void migrate(std::size_t steps) noexcept {
+            for (; steps && migrated_groups < previous.group_count; --steps, ++migrated_groups) {
+                auto &g = previous.groups[migrated_groups];
+                for (std::size_t i = 0; i < group_width; ++i) {
+                    if (g.ctrl[i] >= 0) {
+                        auto &e = previous.entries[migrated_groups * group_width + i];
+                        insert_unique(current, e.id, mix(e.id), e.activation);
+                        g.ctrl[i] = deleted_slot;
+                        --previous.size;
+                    }
+                }
+            }
+            if (previous.group_count && (migrated_groups == previous.group_count || !previous.size)) {
+                previous = table();
+                migrated_groups = 0;
+            }
+        }
+
+        void grow() {
+            // A second growth before the previous one completed is rare enough to be finished synchronously
+            migrate(previous.group_count);
+
+            std::size_t count = 1;
+            while (count * group_width < (current.size + 1) * 2) {
+                count <<= 1U;
+            }
+            previous = std::exchange(current, table(count));
+            migrated_groups = 0;
+            migrate(migration_step);
+        }
+
+        Actor *allocate() {
+            if (!free_slots.empty()) {
+                auto ptr = free_slots.back();
+                free_slots.pop_back();
+                return ptr;
+            }
+            if (slab_used == slab_capacity) {
+                slabs.emplace_back(new storage_type[slab_capacity]);
+                slab_used = 0;
+            }
+            return reinterpret_cast<Actor *>(&slabs.back()[slab_used++]);
+        }
+
+        void release(Actor *activation) noexcept {
+            activation->~Actor();
+            free_slots.push_back(activation);
+        }
+
+        template<typename Func>
+        static void for_each_in(table &t, Func &&func) {
+            for (std::size_t slot = 0; slot < t.capacity(); ++slot) {
+                if (t.groups[slot / group_width].ctrl[slot % group_width] >= 0) {
+                    func(t.entries[slot]);
+                }
+            }
+        }
+
+    public:
+        flat_directory() = default;
+
+        flat_directory(flat_directory const &) = delete;
+
+        flat_directory &operator=(flat_directory const &) = delete;
+
+        ~flat_directory() {
+            clear();
+        }
+
+        /// \returns The activation with the given id, or `nullptr`
+        [[nodiscard]] Actor *find(std::size_t id) const noexcept {
+            auto hash = mix(id);
+            if (auto slot = find_in(current, id, hash); slot >= 0) {
+                return current.entries[slot].activation;
+            }
+            if (auto slot = find_in(previous, id, hash); slot >= 0) {
+                return previous.entries[slot].activation;
+            }
+            return nullptr;
+        }
+
+        /// \returns The activation with the given id, constructing it from key if it doesn't exist
+        template<typename KeyType>
+        Actor *try_emplace(std::size_t id, KeyType &&key) {
+            if (auto activation = find(id)) {
+                return activation;
+            }
+            if (!current.group_count || current.needs_growth()) {
+                grow();
+            } else {
+                migrate(migration_step);
+            }
+            auto storage = allocate();
+            Actor *activation;
+            try {
+                activation = new(storage) Actor(std::forward<KeyType>(key));
+            } catch (...) {
+                free_slots.push_back(storage);
+                throw;
+            }
+            insert_unique(current, id, mix(id), activation);
+            return activation;
+        }
+
+        /// \effects Destroys the activation with the given id, if any
+        /// \returns `true` if an activation was destroyed
+        bool erase(std::size_t id) noexcept {
+            auto hash = mix(id);
+            for (auto t : {&current, &previous}) {
+                if (auto slot = find_in(*t, id, hash); slot >= 0) {
+                    release(t->entries[slot].activation);
+                    erase_slot(*t, static_cast<std::size_t>(slot));
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// \effects Calls func with the id and activation of every entry
+        template<typename Func>
+        void for_each(Func &&func) {
+            auto visit = [&func](entry &e) { func(e.id, *e.activation); };
+            for_each_in(current, visit);
+            for_each_in(previous, visit);
+        }
+
+        [[nodiscard]] std::size_t size() const noexcept {
+            return current.size + previous.size;
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return !size();
+        }
+
+        /// \effects Destroys every activation and releases all memory
+        void clear() noexcept {
+            auto destroy = [](entry &e) { e.activation->~Actor(); };
+            for_each_in(current, destroy);
+            for_each_in(previous, destroy);
+            current = table();
+            previous = table();
+            migrated_groups = 0;
+            slabs.clear();
+            slab_used = slab_capacity;
+            free_slots.clear();
+        }
+    };
+}
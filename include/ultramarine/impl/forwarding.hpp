@@ -0,0 +1,214 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <exception>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <seastar/core/future.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/smp.hh>
+#include <seastar/util/noncopyable_function.hh>
+
+namespace ultramarine {
+
+    /// Exception returned by a message whose handler forwarded its reply, then returned a result of its own
+    /// \unique_name ultramarine::reply_already_forwarded
+    struct reply_already_forwarded : public std::exception {
+        const char *what() const noexcept override {
+            return "Handler returned a result after forwarding its reply";
+        }
+    };
+}
+
+namespace ultramarine::impl {
+    // The exception carried by the future a handler returns after forwarding its reply. It never reaches user code:
+    // the reply channel recognizes it and waits for the actor the message was forwarded to.
+    struct reply_forwarded {
+    };
+
+    // The promise of the first actor of a forwarding chain. It stays on the shard that created it, and is completed
+    // directly by the last actor of the chain.
+    template<typename Future>
+    struct reply_channel {
+        typename seastar::futurize<Future>::promise_type promise;
+        seastar::shard_id origin = seastar::engine().cpu_id();
+
+        static std::exception_ptr const &forwarded_marker() {
+            static thread_local std::exception_ptr marker = std::make_exception_ptr(reply_forwarded{});
+            return marker;
+        }
+
+        static Future forwarded() {
+            return seastar::futurize<Future>::make_exception_future(forwarded_marker());
+        }
+
+        // Deliver the result of the last actor of the chain. Ownership of the channel is released.
+        static void complete(reply_channel *channel, Future &&f) {
+            if (channel->origin == seastar::engine().cpu_id()) {
+                f.forward_to(std::move(channel->promise));
+                delete channel;
+            } else if (f.failed()) {
+                (void) seastar::smp::submit_to(channel->origin, [channel, ex = f.get_exception()]() mutable {
+                    channel->promise.set_exception(std::move(ex));
+                    delete channel;
+                });
+            } else {
+                (void) seastar::smp::submit_to(channel->origin, [channel, value = f.get()]() mutable {
+                    std::apply([channel](auto &&... value) {
+                        channel->promise.set_value(std::forward<decltype(value)>(value) ...);
+                    }, std::move(value));
+                    delete channel;
+                });
+            }
+        }
+
+        // Wait for the result of a handler invoked on behalf of the channel, and complete the channel with it unless
+        // the handler forwarded the reply further down the chain
+        static seastar::future<> settle(reply_channel *channel, Future &&f) {
+            return f.then_wrapped([channel](Future &&f) {
+                if (f.failed()) {
+                    auto ex = f.get_exception();
+                    if (ex != forwarded_marker()) {
+                        complete(channel, seastar::futurize<Future>::make_exception_future(std::move(ex)));
+                    }
+                } else {
+                    complete(channel, std::move(f));
+                }
+            });
+        }
+    };
+
+    // Tags a message forwarded on behalf of a reply channel
+    template<typename Handler, typename Future>
+    struct forwarded_message {
+        Handler handler;
+        reply_channel<Future> *channel;
+    };
+
+    template<typename Handler>
+    struct is_forwarded_message : std::false_type {
+    };
+
+    template<typename Handler, typename Future>
+    struct is_forwarded_message<forwarded_message<Handler, Future>> : std::true_type {
+    };
+
+    template<typename Future>
+    inline constexpr char forwarding_type_tag = 0;
+
+    using pending_forward = std::optional<seastar::noncopyable_function<void()>>;
+
+    // The reply channel of the handler currently executing, if it was invoked through a forwarded message.
+    // A forward() claiming the channel leaves its message in pending rather than sending it right away.
+    struct forwarding_frame {
+        void *channel = nullptr;
+        void const *type = nullptr;
+        pending_forward *pending = nullptr;
+    };
+
+    inline thread_local forwarding_frame current_forwarding_frame;
+
+    template<typename Handler>
+    inline forwarding_frame frame_of(Handler const &) noexcept {
+        return forwarding_frame{};
+    }
+
+    template<typename Handler, typename Future>
+    inline forwarding_frame frame_of(forwarded_message<Handler, Future> const &message) noexcept {
+        return forwarding_frame{message.channel, &forwarding_type_tag<Future>};
+    }
+
+    // Exposes the reply channel of a forwarded message to the handler it invokes, and hides it from anything else
+    class forwarding_scope {
+        forwarding_frame saved;
+        pending_forward pending;
+
+    public:
+        explicit forwarding_scope(forwarding_frame frame) noexcept {
+            if (frame.channel) {
+                frame.pending = &pending;
+            }
+            saved = std::exchange(current_forwarding_frame, frame);
+        }
+
+        forwarding_scope(forwarding_scope const &) = delete;
+
+        ~forwarding_scope() {
+            current_forwarding_frame = saved;
+        }
+
+        // Sends the message the handler forwarded its reply to, once the handler has returned the forwarded marker.
+        // Any other result would complete the reply channel a second time, so the message fails instead.
+        template<typename Future>
+        Future release(Future &&f) {
+            if (!pending) {
+                return std::move(f);
+            }
+            return f.then_wrapped([send = std::move(*pending)](Future &&f) mutable {
+                if (!f.failed()) {
+                    f.ignore_ready_future();
+                    return seastar::futurize<Future>::make_exception_future(reply_already_forwarded());
+                }
+                auto ex = f.get_exception();
+                if (ex == reply_channel<Future>::forwarded_marker()) {
+                    send();
+                }
+                return seastar::futurize<Future>::make_exception_future(std::move(ex));
+            });
+        }
+    };
+
+    // Whether the running handler returns Future and was invoked through a forwarded message whose reply channel
+    // it hasn't claimed yet. A handler can only forward its reply once.
+    template<typename Future>
+    inline bool can_forward_reply() noexcept {
+        return current_forwarding_frame.type == &forwarding_type_tag<Future>;
+    }
+
+    // Claim the reply channel of the running handler. send receives the channel once the handler has returned.
+    template<typename Future, typename Send>
+    inline void forward_reply(Send &&send) {
+        auto frame = std::exchange(current_forwarding_frame, {});
+        frame.pending->emplace([channel = static_cast<reply_channel<Future> *>(frame.channel),
+                                       send = std::forward<Send>(send)]() mutable {
+            send(channel);
+        });
+    }
+
+    // Forward the eventual result of a message that cannot carry a reply channel, such as one sent to a remote node
+    template<typename Future>
+    inline Future forward_result(Future &&f) {
+        if (can_forward_reply<Future>()) {
+            forward_reply<Future>([f = std::move(f)](reply_channel<Future> *channel) mutable {
+                (void) reply_channel<Future>::settle(channel, std::move(f));
+            });
+            return reply_channel<Future>::forwarded();
+        }
+        return std::move(f);
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+#include <seastar/core/sharded.hh>
+#include <seastar/core/temporary_buffer.hh>
+
+namespace ultramarine {
+
+    /// Trait marking the message argument types whose storage is handed off to the destination shard instead of
+    /// being moved there
+    /// \unique_name ultramarine::is_handoff_payload
+    /// \notes A handed-off argument is heap-allocated on the sending shard and wrapped in a `seastar::foreign_ptr`.
+    /// The handler receives it as an rvalue reference and, as long as it takes it by reference, the payload is
+    /// released on the shard that allocated it. Specialize this trait to opt other large or move-only types in.
+    /// A specialization may declare `static std::size_t size(T const &)`: payloads smaller than 4 KiB are then moved
+    /// along with the message, as handing them off would cost more than it saves.
+    template<typename T>
+    struct is_handoff_payload : std::false_type {
+    };
+
+    template<typename T, typename Allocator>
+    struct is_handoff_payload<std::vector<T, Allocator>> : std::true_type {
+        static std::size_t size(std::vector<T, Allocator> const &payload) noexcept {
+            return payload.size() * sizeof(T);
+        }
+    };
+
+    template<typename CharType>
+    struct is_handoff_payload<seastar::temporary_buffer<CharType>> : std::true_type {
+        static std::size_t size(seastar::temporary_buffer<CharType> const &payload) noexcept {
+            return payload.size() * sizeof(CharType);
+        }
+    };
+
+    template<typename T, typename Deleter>
+    struct is_handoff_payload<std::unique_ptr<T, Deleter>> : std::true_type {
+        static std::size_t size(std::unique_ptr<T, Deleter> const &payload) noexcept {
+            if constexpr (std::is_array_v<T>) {
+                return std::numeric_limits<std::size_t>::max();
+            } else {
+                return payload ? sizeof(T) : 0;
+            }
+        }
+    };
+
+    /// \exclude
+    template<typename T>
+    inline constexpr bool is_handoff_payload_v = is_handoff_payload<T>::value;
+
+    namespace impl {
+        static constexpr std::size_t handoff_min_size = 4096;
+
+        template<typename T, typename = void>
+        struct has_payload_size : std::false_type {
+        };
+
+        template<typename T>
+        struct has_payload_size<T, std::void_t<decltype(is_handoff_payload<T>::size(std::declval<T const &>()))>>
+                : std::true_type {
+        };
+
+        // Small payloads travel inline with the message. Only those worth the extra allocation are handed off.
+        template<typename T>
+        struct handoff {
+            std::optional<T> value;
+            seastar::foreign_ptr<std::unique_ptr<T>> ptr;
+
+            explicit handoff(T &&payload) {
+                if constexpr (has_payload_size<T>::value) {
+                    if (is_handoff_payload<T>::size(payload) < handoff_min_size) {
+                        value.emplace(std::move(payload));
+                        return;
+                    }
+                }
+                ptr = seastar::make_foreign(std::make_unique<T>(std::move(payload)));
+            }
+
+            T &get() noexcept {
+                return ptr ? *ptr : *value;
+            }
+        };
+
+        template<typename T>
+        struct is_handoff : std::false_type {
+        };
+
+        template<typename T>
+        struct is_handoff<handoff<T>> : std::true_type {
+        };
+
+        // Only non-const rvalues are handed off: anything else is still copied, as the caller keeps owning it
+        template<typename Arg, typename T = std::decay_t<Arg>>
+        using handoff_t = std::conditional_t<is_handoff_payload_v<T> && !std::is_lvalue_reference_v<Arg> &&
+                                             !std::is_const_v<std::remove_reference_t<Arg>>, handoff<T>, T>;
+
+        template<typename ...Args>
+        inline auto make_handoff_tuple(Args &&... args) {
+            return std::tuple<handoff_t<Args>...>(std::forward<Args>(args) ...);
+        }
+
+        template<typename Arg, typename T>
+        inline constexpr decltype(auto) forward_handoff(T &value) noexcept {
+            if constexpr (is_handoff<T>::value) {
+                return std::move(value);
+            } else {
+                return std::forward<Arg>(value);
+            }
+        }
+
+        template<typename T>
+        inline constexpr decltype(auto) unwrap_handoff(T &&value) noexcept {
+            if constexpr (is_handoff<std::decay_t<T>>::value) {
+                return std::move(value.get());
+            } else {
+                return std::forward<T>(value);
+            }
+        }
+    }
+}
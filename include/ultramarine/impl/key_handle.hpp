@@ -0,0 +1,156 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/smp.hh>
+
+namespace ultramarine::impl {
+
+    // Keys that fit in a pointer and copy as plain bytes are stored in the reference itself
+    template<typename Key>
+    inline constexpr bool is_inline_key_v = std::is_trivially_copyable_v<Key> && sizeof(Key) <= sizeof(void *);
+
+    // Any other key is interned in a per-shard table, so that references only carry a pointer to it. An interned key
+    // is immutable and may be read from any shard; it is released on the shard that interned it once the last
+    // reference to it is dropped.
+    template<typename Key>
+    class key_interner {
+    public:
+        struct entry {
+            Key const key;
+            std::size_t const hash;
+            seastar::shard_id const owner = seastar::engine().cpu_id();
+            std::atomic<std::size_t> refs = 1;
+
+            entry(Key &&key, std::size_t hash) : key(std::move(key)), hash(hash) {}
+        };
+
+    private:
+        static inline thread_local std::unordered_multimap<std::size_t, entry *> table;
+
+        // An entry whose count dropped to zero is dead for good: it is never handed out again
+        static bool try_acquire(entry *e) noexcept {
+            auto refs = e->refs.load(std::memory_order_relaxed);
+            while (refs) {
+                if (e->refs.compare_exchange_weak(refs, refs + 1, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static void dispose(entry *e) {
+            auto range = table.equal_range(e->hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == e) {
+                    table.erase(it);
+                    break;
+                }
+            }
+            delete e;
+        }
+
+    public:
+        template<typename KeyType>
+        static entry *intern(KeyType &&key, std::size_t hash) {
+            auto range = table.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second->key == key && try_acquire(it->second)) {
+                    return it->second;
+                }
+            }
+            auto e = new entry(Key(std::forward<KeyType>(key)), hash);
+            table.emplace(hash, e);
+            return e;
+        }
+
+        static void acquire(entry *e) noexcept {
+            e->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static void release(entry *e) noexcept {
+            if (e->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (e->owner == seastar::engine().cpu_id()) {
+                    dispose(e);
+                } else {
+                    (void) seastar::smp::submit_to(e->owner, [e] {
+                        dispose(e);
+                    });
+                }
+            }
+        }
+    };
+
+    // The key of an actor, as held by references to it. Copying a handle never allocates.
+    template<typename Key, bool Inline = is_inline_key_v<Key>>
+    class key_handle {
+        Key key;
+
+    public:
+        template<typename KeyType>
+        key_handle(KeyType &&key, std::size_t) : key(std::forward<KeyType>(key)) {}
+
+        Key const &get() const noexcept {
+            return key;
+        }
+    };
+
+    template<typename Key>
+    class key_handle<Key, false> {
+        using interner = key_interner<Key>;
+        typename interner::entry *e;
+
+    public:
+        template<typename KeyType>
+        key_handle(KeyType &&key, std::size_t hash) : e(interner::intern(std::forward<KeyType>(key), hash)) {}
+
+        key_handle(key_handle const &other) noexcept : e(other.e) {
+            interner::acquire(e);
+        }
+
+        key_handle(key_handle &&other) noexcept : e(std::exchange(other.e, nullptr)) {}
+
+        key_handle &operator=(key_handle other) noexcept {
+            std::swap(e, other.e);
+            return *this;
+        }
+
+        ~key_handle() {
+            if (e) {
+                interner::release(e);
+            }
+        }
+
+        Key const &get() const noexcept {
+            return e->key;
+        }
+    };
+}
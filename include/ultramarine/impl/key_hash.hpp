@@ -0,0 +1,198 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ultramarine {
+
+    ///\exclude
+    namespace impl {
+        static constexpr std::uint64_t hash_secret[] = {
+                0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL, 0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL,
+                0x1d8e4e27c47d124fULL, 0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL
+        };
+
+        static constexpr std::uint64_t hash_scramble_prime = 0x9E3779B1U;
+
+        // Number of 64-byte stripes accumulated between two scrambles of the accumulators
+        static constexpr std::size_t hash_stripes_per_block = 16;
+
+        inline std::uint64_t hash_mum(std::uint64_t a, std::uint64_t b) noexcept {
+            auto r = static_cast<unsigned __int128>(a) * b;
+            return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64U);
+        }
+
+        inline std::uint64_t hash_read64(unsigned char const *p) noexcept {
+            std::uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint64_t hash_read32(unsigned char const *p) noexcept {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint64_t hash_integer(std::uint64_t value) noexcept {
+            return hash_mum(value ^ hash_secret[0], hash_secret[1]);
+        }
+
+        // Inputs of 64 bytes or more are accumulated in eight independent 64-bit lanes, the same way XXH3 does.
+        // The SSE2 and scalar paths compute the exact same value: keys hash identically on every node of a cluster.
+        struct hash_accumulator {
+            alignas(16) std::uint64_t acc[8] = {
+                    hash_secret[0], hash_secret[1], hash_secret[2], hash_secret[3],
+                    hash_secret[4], hash_secret[5], hash_secret[6], hash_secret[7]
+            };
+
+            void stripe(unsigned char const *p) noexcept {
+#ifdef __SSE2__
+                for (std::size_t i = 0; i < 8; i += 2) {
+                    auto *lane = reinterpret_cast<__m128i *>(acc + i);
+                    auto data = _mm_loadu_si128(reinterpret_cast<__m128i const *>(p + i * 8));
+                    auto key = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<__m128i const *>(hash_secret + i)));
+                    auto product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+                    auto swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+                    _mm_store_si128(lane, _mm_add_epi64(_mm_load_si128(lane), _mm_add_epi64(product, swapped)));
+                }
+#else
+                for (std::size_t i = 0; i < 8; ++i) {
+                    auto data = hash_read64(p + i * 8);
+                    auto key = data ^ hash_secret[i];
+                    acc[i ^ 1U] += data;
+                    acc[i] += (key & 0xFFFFFFFFU) * (key >> 32U);
+                }
+#endif
+            }
+
+            void scramble() noexcept {
+#ifdef __SSE2__
+                auto prime = _mm_set1_epi32(static_cast<int>(hash_scramble_prime));
+                for (std::size_t i = 0; i < 8; i += 2) {
+                    auto *lane = reinterpret_cast<__m128i *>(acc + i);
+                    auto value = _mm_load_si128(lane);
+                    value = _mm_xor_si128(value, _mm_srli_epi64(value, 47));
+                    value = _mm_xor_si128(value,
+                                          _mm_loadu_si128(reinterpret_cast<__m128i const *>(hash_secret + (i ^ 4U))));
+                    auto low = _mm_mul_epu32(value, prime);
+                    auto high = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+                    _mm_store_si128(lane, _mm_add_epi64(low, _mm_slli_epi64(high, 32)));
+                }
+#else
+                for (std::size_t i = 0; i < 8; ++i) {
+                    auto value = acc[i] ^ (acc[i] >> 47U) ^ hash_secret[i ^ 4U];
+                    acc[i] = value * hash_scramble_prime;
+                }
+#endif
+            }
+
+            std::uint64_t merge(std::uint64_t seed) const noexcept {
+                for (std::size_t i = 0; i < 8; i += 2) {
+                    seed = hash_mum(acc[i] ^ seed, acc[i + 1] ^ hash_secret[i]);
+                }
+                return seed;
+            }
+        };
+
+        // wyhash for short inputs, with the accumulator above in front of it for long ones
+        inline std::uint64_t hash_bytes(void const *data, std::size_t len) noexcept {
+            auto p = static_cast<unsigned char const *>(data);
+            std::uint64_t seed = hash_secret[0] ^ hash_mum(len ^ hash_secret[2], hash_secret[1]);
+            std::uint64_t a = 0, b = 0;
+            if (len <= 16) {
+                if (len >= 4) {
+                    a = (hash_read32(p) << 32U) | hash_read32(p + ((len >> 3U) << 2U));
+                    b = (hash_read32(p + len - 4) << 32U) | hash_read32(p + len - 4 - ((len >> 3U) << 2U));
+                } else if (len > 0) {
+                    a = (std::uint64_t(p[0]) << 16U) | (std::uint64_t(p[len >> 1U]) << 8U) | p[len - 1];
+                }
+            } else {
+                auto remaining = len;
+                if (remaining >= 64) {
+                    hash_accumulator accumulator;
+                    std::size_t stripes = 0;
+                    for (; remaining >= 64; remaining -= 64, p += 64) {
+                        accumulator.stripe(p);
+                        if (++stripes % hash_stripes_per_block == 0) {
+                            accumulator.scramble();
+                        }
+                    }
+                    seed = accumulator.merge(seed);
+                }
+                for (; remaining > 16; remaining -= 16, p += 16) {
+                    seed = hash_mum(hash_read64(p) ^ hash_secret[1], hash_read64(p + 8) ^ seed);
+                }
+                a = hash_read64(p + remaining - 16);
+                b = hash_read64(p + remaining - 8);
+            }
+            return hash_mum(hash_secret[1] ^ len, hash_mum(a ^ hash_secret[1], b ^ seed));
+        }
+    }
+
+    /// The default [ultramarine::actor::Hasher](), mixing every bit of the key into the hash
+    /// \unique_name ultramarine::default_key_hasher
+    /// \notes Integers and enumerations are mixed with a 128-bit multiply, so that sequential or strided keys spread
+    /// evenly across shards. Keys convertible to `std::string_view` are hashed from their bytes, using SSE2 when
+    /// available. Any other key is hashed with `std::hash` first, then mixed.
+    struct default_key_hasher {
+        /// \param key The [ultramarine::actor::KeyType]() to hash
+        /// \returns The hash of `key`
+        template<typename Key>
+        std::size_t operator()(Key const &key) const noexcept {
+            if constexpr (std::is_integral_v<Key> || std::is_enum_v<Key>) {
+                return impl::hash_integer(static_cast<std::uint64_t>(key));
+            } else if constexpr (std::is_convertible_v<Key const &, std::string_view>) {
+                std::string_view view = key;
+                return impl::hash_bytes(view.data(), view.size());
+            } else {
+                return impl::hash_integer(std::hash<Key>{}(key));
+            }
+        }
+    };
+
+    /// An [ultramarine::actor::Hasher]() that hashes keys with `std::hash`, the identity for integers
+    /// \unique_name ultramarine::identity_key_hasher
+    /// \notes With the default placement strategy, the actor of key `k` then lives on shard `k % seastar::smp::count`.
+    /// This is useful to place actors explicitly, at the cost of skew with structured keys.
+    struct identity_key_hasher {
+        /// \param key The [ultramarine::actor::KeyType]() to hash
+        /// \returns The hash of `key`
+        template<typename Key>
+        std::size_t operator()(Key const &key) const noexcept {
+            return std::hash<Key>{}(key);
+        }
+    };
+}
@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <boost/preprocessor/cat.hpp>
 #include <boost/preprocessor/seq/for_each_i.hpp>
 #include <boost/hana.hpp>
 #include <seastar/core/future.hh>
@@ -48,10 +49,29 @@ tag(Args &&... args) const {
     return ref.tell(ULTRAMARINE_MAKE_IDENTITY(data, tag), std::forward<Args>(args) ...);                    \
 }                                                                                                           \
 
+/// \exclude
+#define ULTRAMARINE_MAKE_POST_TAG(a, data, i, tag)                                                          \
+template<typename ...Args>                                                                                  \
+inline void BOOST_PP_CAT(post_, tag)(Args &&... args) const {                                               \
+    ref.post(ULTRAMARINE_MAKE_IDENTITY(data, tag), std::forward<Args>(args) ...);                           \
+}                                                                                                           \
+
 /// \exclude
 #define ULTRAMARINE_MAKE_TUPLE(a, data, i, name)                                                            \
     boost::hana::make_pair(ULTRAMARINE_MAKE_IDENTITY(data, name), &data::name),                             \
 
+/// \exclude
+#define ULTRAMARINE_MAKE_BATCH_TAG(a, data, i, tag)                                                         \
+template<typename T = data>                                                                                 \
+static constexpr auto batch_handler(decltype(ULTRAMARINE_MAKE_IDENTITY(data, tag)), int)                    \
+        -> decltype(&T::BOOST_PP_CAT(tag, _batch)) { return &T::BOOST_PP_CAT(tag, _batch); }                \
+
+/// \exclude
+#define ULTRAMARINE_MAKE_BATCH_VTABLE(name, seq)                                                            \
+BOOST_PP_SEQ_FOR_EACH_I(ULTRAMARINE_MAKE_BATCH_TAG, name, seq)                                              \
+template<typename Handler>                                                                                  \
+static constexpr std::nullptr_t batch_handler(Handler, long) { return nullptr; }                            \
+
 /// \exclude
 #define ULTRAMARINE_MAKE_VTABLE(name, seq)                                                                  \
 static constexpr auto make_vtable() {                                                                       \
@@ -83,9 +103,16 @@ static constexpr auto make_vtable() {
 /// \unique_name ULTRAMARINE_DEFINE_ACTOR
 /// \requires `name` shall be a [ultramarine::actor]() derived type
 /// \requires `seq` shall be a sequence of zero or more message handler (Example: `(handler1)(handler2)`)
+/// \notes A handler `foo` may be paired with a batch handler named `foo_batch`, taking an
+/// [ultramarine::packed_arguments]() of the arguments of `foo`. Packed messages, such as the ones sent by
+/// [ultramarine::deduplicate](), then call `foo_batch` once instead of calling `foo` once per element. `foo_batch`
+/// shall return `void` or `seastar::future<>` if `foo` returns nothing, and a `std::vector` of the results otherwise.
+/// \notes Each handler `foo` is also exposed as `post_foo` on the actor interface, which posts the message without
+/// waiting for a reply (see [ultramarine::actor_ref]()).
 #define ULTRAMARINE_DEFINE_ACTOR(name, seq)                                                                 \
 private:                                                                                                    \
       KeyType key;                                                                                          \
+      template<typename> friend struct ultramarine::impl::migration_service;                                \
 public:                                                                                                     \
       explicit name(KeyType &&key) noexcept : key(std::move(key)) { }                                       \
       struct internal {                                                                                     \
@@ -98,6 +125,7 @@ public:
               explicit interface(interface const&) = delete;                                                \
               explicit interface(interface &&) = delete;                                                    \
               BOOST_PP_SEQ_FOR_EACH_I(ULTRAMARINE_MAKE_TAG_ALT, name, seq)                                  \
+              BOOST_PP_SEQ_FOR_EACH_I(ULTRAMARINE_MAKE_POST_TAG, name, seq)                                 \
               constexpr auto operator->(){ return this; }                                                   \
           };                                                                                                \
           struct message {                                                                                  \
@@ -105,6 +133,7 @@ public:
           private:                                                                                          \
               friend class ultramarine::impl::vtable<name>;                                                 \
               ULTRAMARINE_MAKE_VTABLE(name, seq)                                                            \
+              ULTRAMARINE_MAKE_BATCH_VTABLE(name, seq)                                                      \
               ULTRAMARINE_REMOTE_MAKE_VTABLE(name, seq)                                                     \
           };                                                                                                \
       };                                                                                                    \
@@ -0,0 +1,354 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <deque>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <seastar/core/future.hh>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/timer.hh>
+
+namespace ultramarine {
+
+    /// Policy applied by a [ultramarine::non_reentrant_actor]() mailbox when a message arrives and the mailbox is full
+    /// \unique_name ultramarine::mailbox_policy
+    enum class mailbox_policy {
+        /// The sender waits for a queued message to leave the mailbox before its own message is admitted. The wait counts
+        /// towards the mailbox timeout
+        block,
+        /// The message fails immediately with [ultramarine::mailbox_full]()
+        fail_fast,
+        /// The oldest queued message fails with [ultramarine::message_dropped]() to make room for the new one
+        drop_oldest
+    };
+
+    /// Exception returned by a message sent to a full [ultramarine::non_reentrant_actor]() mailbox
+    /// \unique_name ultramarine::mailbox_full
+    struct mailbox_full : public std::exception {
+        const char *what() const noexcept override {
+            return "Actor mailbox is full";
+        }
+    };
+
+    /// Exception returned by a message evicted from a [ultramarine::non_reentrant_actor]() mailbox by a newer one
+    /// \unique_name ultramarine::message_dropped
+    struct message_dropped : public std::exception {
+        const char *what() const noexcept override {
+            return "Message dropped from actor mailbox";
+        }
+    };
+
+    /// Exception returned by a message that waited in a [ultramarine::non_reentrant_actor]() mailbox for too long
+    /// \unique_name ultramarine::mailbox_timed_out
+    struct mailbox_timed_out : public std::exception {
+        const char *what() const noexcept override {
+            return "Message timed out in actor mailbox";
+        }
+    };
+
+    namespace impl {
+
+        struct mailbox_message {
+            mailbox_message *next = nullptr;
+            seastar::lowres_clock::time_point deadline;
+            bool shared = false;
+
+            virtual ~mailbox_message() = default;
+
+            // Runs the handler and forwards its result to the sender. The returned future never fails.
+            virtual seastar::future<> run() noexcept = 0;
+
+            virtual void fail(std::exception_ptr ex) noexcept = 0;
+        };
+
+        template<typename Func>
+        class mailbox_message_impl final : public mailbox_message {
+            using futurator = seastar::futurize<std::result_of_t<Func()>>;
+            using future_type = typename futurator::type;
+
+            Func func;
+            typename futurator::promise_type promise;
+
+        public:
+            explicit mailbox_message_impl(Func &&func) : func(std::move(func)) {}
+
+            future_type get_future() noexcept {
+                return promise.get_future();
+            }
+
+            seastar::future<> run() noexcept override {
+                auto f = futurator::apply(func);
+                if (f.available()) {
+                    f.forward_to(std::move(promise));
+                    return seastar::make_ready_future();
+                }
+                return f.then_wrapped([this](future_type &&f) {
+                    f.forward_to(std::move(promise));
+                });
+            }
+
+            void fail(std::exception_ptr ex) noexcept override {
+                promise.set_exception(std::move(ex));
+            }
+        };
+
+        // Intrusive FIFO serializing the messages of a non-reentrant activation.
+        // A message sent to an idle mailbox runs immediately and is never queued. Queued messages are drained back to
+        // back as long as their handlers complete synchronously and the reactor doesn't ask for preemption.
+        // Shared messages may run alongside each other, but never alongside an exclusive one. A shared message arriving
+        // while others are queued waits behind them, so a queued exclusive message is never starved.
+        // Under the block policy, senders finding the mailbox full wait in arrival order. Each message leaving the queue
+        // reserves its slot for the oldest waiter, which is then admitted behind the messages already queued.
+        template<std::size_t Capacity, mailbox_policy Policy, std::size_t Timeout>
+        class mailbox {
+            mailbox_message *head = nullptr;
+            mailbox_message *tail = nullptr;
+            std::size_t size = 0;
+            std::size_t readers = 0;
+            bool busy = false;
+            seastar::timer<seastar::lowres_clock> expiry;
+
+            struct waiter {
+                seastar::promise<> promise;
+                seastar::lowres_clock::time_point deadline;
+            };
+
+            std::deque<waiter> waiters;
+            std::size_t reserved = 0;
+
+            void push(mailbox_message *msg) noexcept {
+                if (tail) {
+                    tail->next = msg;
+                } else {
+                    head = msg;
+                }
+                tail = msg;
+                ++size;
+            }
+
+            std::unique_ptr<mailbox_message> pop() noexcept {
+                auto msg = head;
+                head = msg->next;
+                if (!head) {
+                    tail = nullptr;
+                }
+                --size;
+                wake();
+                return std::unique_ptr<mailbox_message>(msg);
+            }
+
+            [[nodiscard]] bool full() const noexcept {
+                return size + reserved >= Capacity || !waiters.empty();
+            }
+
+            // Hands the slots freed by departing messages to the oldest blocked senders
+            void wake() noexcept {
+                if constexpr (Policy == mailbox_policy::block) {
+                    while (!waiters.empty() && size + reserved < Capacity) {
+                        ++reserved;
+                        waiters.front().promise.set_value();
+                        waiters.pop_front();
+                    }
+                }
+            }
+
+            void arm_expiry() noexcept {
+                if constexpr (Timeout > 0) {
+                    if (expiry.armed()) {
+                        return;
+                    }
+                    if (head && (waiters.empty() || head->deadline <= waiters.front().deadline)) {
+                        expiry.arm(head->deadline);
+                    } else if (!waiters.empty()) {
+                        expiry.arm(waiters.front().deadline);
+                    }
+                }
+            }
+
+            void expire() noexcept {
+                auto now = seastar::lowres_clock::now();
+                while (head && head->deadline <= now) {
+                    pop()->fail(std::make_exception_ptr(mailbox_timed_out()));
+                }
+                while (!waiters.empty() && waiters.front().deadline <= now) {
+                    waiters.front().promise.set_exception(mailbox_timed_out());
+                    waiters.pop_front();
+                }
+                arm_expiry();
+            }
+
+            template<typename Func>
+            auto enqueue(Func &&func, bool shared, seastar::lowres_clock::time_point deadline) {
+                using message_type = mailbox_message_impl<std::decay_t<Func>>;
+
+                auto msg = new message_type(std::forward<Func>(func));
+                auto fut = msg->get_future();
+                msg->shared = shared;
+                msg->deadline = deadline;
+                push(msg);
+                arm_expiry();
+                return fut;
+            }
+
+            [[nodiscard]] bool admits(bool shared) const noexcept {
+                return !busy && (shared || !readers);
+            }
+
+            void acquire(bool shared) noexcept {
+                if (shared) {
+                    ++readers;
+                } else {
+                    busy = true;
+                }
+            }
+
+            void release(bool shared) noexcept {
+                if (shared) {
+                    --readers;
+                } else {
+                    busy = false;
+                }
+            }
+
+            void drain() noexcept {
+                while (head && admits(head->shared)) {
+                    if (seastar::need_preempt()) {
+                        busy = true;
+                        (void) seastar::later().then([this] {
+                            busy = false;
+                            drain();
+                        });
+                        return;
+                    }
+                    auto msg = pop();
+                    auto shared = msg->shared;
+                    acquire(shared);
+                    auto f = msg->run();
+                    if (!f.available()) {
+                        (void) f.then([this, msg = std::move(msg), shared] {
+                            release(shared);
+                            drain();
+                        });
+                        continue;
+                    }
+                    release(shared);
+                }
+                if constexpr (Timeout > 0) {
+                    if (head || !waiters.empty()) {
+                        arm_expiry();
+                    } else {
+                        expiry.cancel();
+                    }
+                }
+            }
+
+        public:
+            mailbox() {
+                if constexpr (Timeout > 0) {
+                    expiry.set_callback([this] { expire(); });
+                }
+            }
+
+            mailbox(mailbox const &) = delete;
+
+            mailbox &operator=(mailbox const &) = delete;
+
+            ~mailbox() {
+                for (auto &w : waiters) {
+                    w.promise.set_exception(seastar::broken_promise());
+                }
+                waiters.clear();
+                while (head) {
+                    pop()->fail(std::make_exception_ptr(seastar::broken_promise()));
+                }
+            }
+
+            // Whether a message may run right away. Shared messages don't overtake queued ones.
+            [[nodiscard]] bool idle(bool shared = false) const noexcept {
+                return !head && admits(shared) && !reserved && waiters.empty();
+            }
+
+            // Number of messages queued behind the running ones, blocked senders excluded
+            [[nodiscard]] std::size_t pending() const noexcept {
+                return size;
+            }
+
+            // Marks the mailbox busy on behalf of a message run directly by the caller
+            void enter(bool shared = false) noexcept {
+                acquire(shared);
+            }
+
+            // Releases the mailbox once f, the result of a message run directly by the caller, is available
+            template<typename Future>
+            Future leave(Future &&f, bool shared = false) noexcept {
+                if (f.available()) {
+                    release(shared);
+                    drain();
+                    return std::move(f);
+                }
+                return f.then_wrapped([this, shared](Future &&f) {
+                    release(shared);
+                    drain();
+                    return std::move(f);
+                });
+            }
+
+            template<typename Func>
+            auto post(Func &&func, bool shared = false) {
+                using futurator = seastar::futurize<std::result_of_t<std::decay_t<Func>()>>;
+
+                seastar::lowres_clock::time_point deadline;
+                if constexpr (Timeout > 0) {
+                    deadline = seastar::lowres_clock::now() + std::chrono::milliseconds(Timeout);
+                }
+
+                if (full()) {
+                    if constexpr (Policy == mailbox_policy::fail_fast) {
+                        return futurator::make_exception_future(mailbox_full());
+                    } else if constexpr (Policy == mailbox_policy::drop_oldest) {
+                        pop()->fail(std::make_exception_ptr(message_dropped()));
+                    } else {
+                        auto &w = waiters.emplace_back();
+                        w.deadline = deadline;
+                        auto admitted = w.promise.get_future();
+                        arm_expiry();
+                        return admitted.then([this, func = std::forward<Func>(func), shared, deadline]() mutable {
+                            --reserved;
+                            auto fut = enqueue(std::move(func), shared, deadline);
+                            drain();
+                            return fut;
+                        });
+                    }
+                }
+
+                return enqueue(std::forward<Func>(func), shared, deadline);
+            }
+        };
+    }
+}
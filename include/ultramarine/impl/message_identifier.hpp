@@ -94,4 +94,10 @@ namespace ultramarine::impl {
         crc ^= 0xFFFFFFFFU;
         return crc &= ~(1U << 0U); // clearing the least-significant bit
     }
+
+    // Identity of the one-way variant of a message. It extends the checksum of the message identity instead of
+    // tagging one of its bits, so that regular identities keep their full range and their value on the wire.
+    static constexpr uint32_t one_way_identity(uint32_t id) {
+        return crc32("!", 1, id);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,373 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <boost/range/irange.hpp>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/shared_future.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/smp.hh>
+#include <ultramarine/impl/actor_traits.hpp>
+#include "shard_set.hpp"
+
+namespace ultramarine::impl {
+
+    template<typename Actor>
+    struct actor_directory;
+
+    /// The maximum number of activations moved off the busiest shard by one rebalancing pass
+    static constexpr std::size_t max_migrations_per_pass = 8;
+
+    // Moves activations of a migratable actor type between shards.
+    // Every shard keeps a routing table of the activations that left their placement. A message that reaches a shard
+    // whose table points elsewhere is forwarded there, and a message that reaches the destination of an ongoing move
+    // waits for the state of the activation to be imported. If the move fails, the messages that waited are sent back
+    // to the shard that kept the activation.
+    template<typename Actor>
+    struct migration_service {
+        using key_type = typename Actor::KeyType;
+
+        struct load_sample {
+            seastar::shard_id shard = 0;
+            std::size_t messages = 0;
+            std::vector<std::tuple<std::size_t, std::size_t, key_type>> hottest;
+        };
+
+        static inline thread_local std::unordered_map<std::size_t, seastar::shard_id> routes;
+        // Resolves with the shard that kept the activation if its move failed
+        using arrival = seastar::shared_promise<std::optional<seastar::shard_id>>;
+
+        static inline thread_local std::unordered_map<std::size_t, arrival> arrivals;
+        static inline thread_local seastar::lowres_clock::time_point last_schedule_request;
+        static inline thread_local bool rebalance_running = false;
+        static inline thread_local std::size_t observed_load = 0;
+
+        template<typename Handler, typename ...Args>
+        using dispatch_future = seastar::futurize_t<decltype(actor_directory<Actor>::dispatch_message_impl(
+                std::declval<Actor *>(), std::declval<Handler>(), std::declval<Args>() ...))>;
+
+        template<typename Handler, typename Arguments>
+        using packed_future = decltype(actor_directory<Actor>::dispatch_packed_activation(
+                std::declval<Actor *>(), std::declval<Handler>(), std::declval<Arguments>()));
+
+        [[nodiscard]] static std::optional<seastar::shard_id> route(std::size_t id) noexcept {
+            if (routes.empty()) {
+                return std::nullopt;
+            }
+            if (auto it = routes.find(id); it != routes.end()) {
+                return it->second;
+            }
+            return std::nullopt;
+        }
+
+        static void acquire(Actor *activation) noexcept {
+            ++activation->pending_messages;
+            ++activation->sampled_messages;
+        }
+
+        static void release(Actor *activation) noexcept {
+            if (!--activation->pending_messages && activation->drained) {
+                activation->drained->set_value();
+                activation->drained.reset();
+            }
+        }
+
+        static seastar::future<> wait_idle(Actor *activation) {
+            if (!activation->pending_messages) {
+                return seastar::make_ready_future();
+            }
+            if (!activation->drained) {
+                activation->drained.emplace();
+            }
+            return activation->drained->get_shared_future();
+        }
+
+        // Runs func here, once the activation can receive messages on this shard, or on the shard it moved to
+        template<typename Future, typename Func>
+        static Future locate(std::size_t id, Func &&func) {
+            if (auto to = route(id)) {
+                return seastar::smp::submit_to(*to, std::forward<Func>(func));
+            }
+            if (!arrivals.empty()) {
+                if (auto arrival = arrivals.find(id); arrival != arrivals.end()) {
+                    return arrival->second.get_shared_future().then([func = std::forward<Func>(func)](
+                            std::optional<seastar::shard_id> fallback) mutable {
+                        if (fallback) {
+                            return seastar::smp::submit_to(*fallback, std::move(func));
+                        }
+                        return func();
+                    });
+                }
+            }
+            return func();
+        }
+
+        template<typename KeyType, typename Handler, typename ...Args>
+        static dispatch_future<Handler, Args...> dispatch(KeyType &&key, std::size_t id, Handler message,
+                                                          Args &&... args) {
+            if (!routes.empty() || !arrivals.empty()) {
+                if (route(id) || arrivals.count(id)) {
+                    return locate<dispatch_future<Handler, Args...>>(id, [key = key_type(key), id, message,
+                            args = std::make_tuple(std::decay_t<Args>(std::forward<Args>(args)) ...)]() mutable {
+                        return std::apply([&key, id, message](auto &&... args) {
+                            return dispatch(key, id, message, std::move(args) ...);
+                        }, std::move(args));
+                    });
+                }
+            }
+            auto activation = actor_directory<Actor>::hold_activation(std::forward<KeyType>(key), id);
+            acquire(activation);
+            return seastar::futurize_apply([activation, message](auto &&... args) {
+                return actor_directory<Actor>::dispatch_message_impl(activation, message,
+                                                                     std::forward<decltype(args)>(args) ...);
+            }, std::forward<Args>(args) ...).finally([activation] {
+                release(activation);
+            });
+        }
+
+        template<typename KeyType, typename Handler, typename Arguments>
+        static packed_future<Handler, Arguments> dispatch_packed(KeyType &&key, std::size_t id, Handler message,
+                                                                 Arguments &&args) {
+            if (route(id) || arrivals.count(id)) {
+                return locate<packed_future<Handler, Arguments>>(id, [key = key_type(key), id, message,
+                        args = std::move(args)]() mutable {
+                    return dispatch_packed(key, id, message, std::move(args));
+                });
+            }
+            auto activation = actor_directory<Actor>::hold_activation(std::forward<KeyType>(key), id);
+            acquire(activation);
+            return actor_directory<Actor>::dispatch_packed_activation(activation, message, std::move(args)).finally(
+                    [activation] {
+                        release(activation);
+                    });
+        }
+
+        // Every shard learns the new location of the activation. Shards forget about it once it is back home.
+        static seastar::future<> publish(std::size_t id, seastar::shard_id to, seastar::shard_id home) {
+            return seastar::smp::invoke_on_all([id, to, home] {
+                if (to == home || seastar::engine().cpu_id() == to) {
+                    routes.erase(id);
+                } else {
+                    routes[id] = to;
+                }
+            });
+        }
+
+        static seastar::future<> import(key_type key, std::size_t id, std::optional<seastar::shard_id> fallback,
+                                        std::function<void(Actor *)> hook) {
+            auto arrival = arrivals.extract(id);
+            if (!fallback) {
+                hook(actor_directory<Actor>::hold_activation(std::move(key), id));
+            } else if (*fallback == actor_directory<Actor>::place(key, id)) {
+                routes.erase(id);
+            } else {
+                routes[id] = *fallback;
+            }
+            if (!arrival.empty()) {
+                arrival.mapped().set_value(fallback);
+            }
+            return seastar::make_ready_future();
+        }
+
+        static seastar::future<> migrate(key_type key, std::size_t id, seastar::shard_id to) {
+            if (to >= seastar::smp::count || hosting_index<Actor>(to) >= hosting_count<Actor>()) {
+                return seastar::make_exception_future<>(
+                        std::invalid_argument("migration target is not a shard hosting the actor"));
+            }
+            if (route(id) || arrivals.count(id)) {
+                return locate<seastar::future<>>(id, [key = std::move(key), id, to]() mutable {
+                    return migrate(std::move(key), id, to);
+                });
+            }
+            auto here = seastar::engine().cpu_id();
+            auto home = actor_directory<Actor>::place(key, id);
+            Actor *activation = Actor::directory ? Actor::directory->find(id) : nullptr;
+            if (to == here || (activation && activation->migrating)) {
+                return seastar::make_ready_future();
+            }
+            if (!activation) {
+                // Nothing to move: the next message activates it on the destination shard
+                return publish(id, to, home);
+            }
+
+            activation->migrating = true;
+            return seastar::smp::submit_to(to, [id] {
+                arrivals.emplace(id, arrival());
+            }).then([activation, id, to] {
+                routes[id] = to;
+                return wait_idle(activation);
+            }).then([activation] {
+                return seastar::futurize_apply([activation] { return activation->export_state(); });
+            }).then_wrapped([key = std::move(key), activation, id, to, here, home](auto &&f) mutable {
+                if (f.failed()) {
+                    activation->migrating = false;
+                    routes.erase(id);
+                    return seastar::smp::submit_to(to, [key = std::move(key), id, here] {
+                        return import(key, id, here, {});
+                    }).then([ex = f.get_exception()] {
+                        return seastar::make_exception_future<>(ex);
+                    });
+                }
+                auto state = std::make_shared<decltype(f.get0())>(f.get0());
+                Actor::directory->erase(id);
+                return publish(id, to, home).then([key = std::move(key), id, to, state]() mutable {
+                    return seastar::smp::submit_to(to, [key = std::move(key), id, state]() mutable {
+                        return import(std::move(key), id, std::nullopt, [state](Actor *activation) {
+                            activation->import_state(std::move(*state));
+                        });
+                    });
+                });
+            });
+        }
+
+        static load_sample sample() {
+            load_sample load{seastar::engine().cpu_id()};
+            if (!Actor::directory) {
+                return load;
+            }
+            std::vector<std::pair<std::size_t, std::size_t>> hottest;
+            Actor::directory->for_each([&load, &hottest](std::size_t id, Actor &activation) {
+                load.messages += activation.sampled_messages;
+                if (activation.sampled_messages && !activation.migrating) {
+                    hottest.emplace_back(activation.sampled_messages, id);
+                }
+                activation.sampled_messages = 0;
+            });
+            auto count = std::min(hottest.size(), max_migrations_per_pass);
+            std::partial_sort(std::begin(hottest), std::begin(hottest) + count, std::end(hottest),
+                              [](auto const &lhs, auto const &rhs) { return lhs.first > rhs.first; });
+            for (std::size_t i = 0; i < count; ++i) {
+                auto[messages, id] = hottest[i];
+                load.hottest.emplace_back(messages, id, Actor::directory->find(id)->key);
+            }
+            return load;
+        }
+
+        // Moves the hottest activations of the busiest shard to the least loaded shards, as long as each move
+        // narrows the gap between them
+        static seastar::future<std::size_t> rebalance() {
+            return seastar::map_reduce(boost::irange<seastar::shard_id>(0, seastar::smp::count), [](auto shard) {
+                return seastar::smp::submit_to(shard, [] { return sample(); });
+            }, std::vector<load_sample>(), [](std::vector<load_sample> samples, load_sample sample) {
+                samples.emplace_back(std::move(sample));
+                return samples;
+            }).then([](std::vector<load_sample> samples) {
+                // Shards are numbered among the shards allowed to host the actor
+                auto hosts = hosting_count<Actor>();
+                std::vector<std::size_t> load(hosts);
+                std::size_t total = 0;
+                for (auto &sample : samples) {
+                    if (auto index = hosting_index<Actor>(sample.shard); index < hosts) {
+                        load[index] = sample.messages;
+                        total += sample.messages;
+                    }
+                }
+                observed_load = total;
+                seastar::shard_id busiest_index = std::max_element(std::begin(load), std::end(load)) - std::begin(load);
+                auto busiest = hosting_shard<Actor>(busiest_index);
+                std::vector<std::tuple<key_type, std::size_t, seastar::shard_id>> moves;
+                if (total && load[busiest_index] * 100 > total * Actor::rebalance_threshold / hosts) {
+                    auto &hottest = std::find_if(std::begin(samples), std::end(samples), [busiest](auto &sample) {
+                        return sample.shard == busiest;
+                    })->hottest;
+                    for (auto &[messages, id, key] : hottest) {
+                        seastar::shard_id coldest =
+                                std::min_element(std::begin(load), std::end(load)) - std::begin(load);
+                        if (messages * 2 > load[busiest_index] - load[coldest]) {
+                            continue;
+                        }
+                        load[busiest_index] -= messages;
+                        load[coldest] += messages;
+                        moves.emplace_back(std::move(key), id, hosting_shard<Actor>(coldest));
+                    }
+                }
+                return seastar::do_with(std::move(moves), [busiest](auto &moves) {
+                    return seastar::parallel_for_each(moves, [busiest](auto &move) {
+                        return seastar::smp::submit_to(busiest, [move]() mutable {
+                            return migrate(std::move(std::get<0>(move)), std::get<1>(move), std::get<2>(move));
+                        });
+                    }).then([&moves] {
+                        return moves.size();
+                    });
+                });
+            });
+        }
+
+        static void run_rebalance() {
+            (void) seastar::sleep<seastar::lowres_clock>(Actor::rebalance_period).then([] {
+                return rebalance();
+            }).then_wrapped([](auto &&f) {
+                f.ignore_ready_future();
+                // Stop once every activation went quiet. The next activation starts the loop again.
+                if (!observed_load) {
+                    rebalance_running = false;
+                    return;
+                }
+                run_rebalance();
+            });
+        }
+
+        // Rebalancing passes are driven from shard 0, which every shard asks at most once per period
+        static void on_activation() {
+            if constexpr (Actor::rebalance_period.count() > 0) {
+                auto now = seastar::lowres_clock::now();
+                if (now - last_schedule_request < Actor::rebalance_period) {
+                    return;
+                }
+                last_schedule_request = now;
+                (void) seastar::smp::submit_to(0, [] {
+                    if (!rebalance_running) {
+                        rebalance_running = true;
+                        run_rebalance();
+                    }
+                });
+            }
+        }
+    };
+}
+
+namespace ultramarine {
+
+    /// Move the hottest activations of the busiest shard to the least loaded shards
+    /// \requires Type `Actor` shall inherit from attribute [ultramarine::migratable_actor]()
+    /// \effects Samples the load of every shard, then moves activations if the busiest shard is above the threshold
+    /// of `Actor`. Load counters are reset
+    /// \returns A future of the number of activations moved
+    template<typename Actor>
+    seastar::future<std::size_t> rebalance() {
+        static_assert(is_migratable_v<Actor>, "rebalance() requires a migratable_actor");
+        return impl::migration_service<Actor>::rebalance();
+    }
+}
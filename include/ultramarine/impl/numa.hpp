@@ -0,0 +1,187 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sched.h>
+#include <boost/range/irange.hpp>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/reactor.hh>
+#include "shard_selection.hpp"
+
+namespace ultramarine::impl {
+
+    /// The number of NUMA nodes probed when discovering the topology
+    static constexpr unsigned max_numa_nodes = 64;
+
+    // The NUMA node of every shard, shared by all shards. Until a topology is set, every shard is considered to be on
+    // a single node. Nodes are numbered densely from zero, in the order of their first shard.
+    struct numa_topology {
+        static inline std::array<std::uint16_t, max_tracked_shards> node_of_shard{};
+        static inline std::array<std::uint16_t, max_tracked_shards> shards_by_node{};
+        static inline std::array<std::uint16_t, max_tracked_shards + 1> node_begin{};
+        static inline std::atomic<unsigned> node_count{0};
+
+        [[nodiscard]] static unsigned nodes() noexcept {
+            auto count = node_count.load(std::memory_order_acquire);
+            return count ? count : 1;
+        }
+
+        [[nodiscard]] static unsigned node_of(seastar::shard_id shard) noexcept {
+            return node_count.load(std::memory_order_acquire) ? node_of_shard[shard] : 0;
+        }
+
+        [[nodiscard]] static seastar::shard_id node_size(unsigned node) noexcept {
+            if (!node_count.load(std::memory_order_acquire)) {
+                return seastar::smp::count;
+            }
+            return node_begin[node + 1] - node_begin[node];
+        }
+
+        [[nodiscard]] static seastar::shard_id shard_at(unsigned node, seastar::shard_id index) noexcept {
+            if (!node_count.load(std::memory_order_acquire)) {
+                return index;
+            }
+            return shards_by_node[node_begin[node] + index];
+        }
+
+        static void set(std::vector<unsigned> const &nodes) {
+            if (nodes.size() != seastar::smp::count || nodes.size() > max_tracked_shards) {
+                return;
+            }
+            std::vector<unsigned> dense;
+            for (auto node : nodes) {
+                if (std::find(std::begin(dense), std::end(dense), node) == std::end(dense)) {
+                    dense.push_back(node);
+                }
+            }
+            std::size_t next = 0;
+            for (unsigned node = 0; node < dense.size(); ++node) {
+                node_begin[node] = next;
+                for (seastar::shard_id shard = 0; shard < nodes.size(); ++shard) {
+                    if (nodes[shard] == dense[node]) {
+                        node_of_shard[shard] = node;
+                        shards_by_node[next++] = shard;
+                    }
+                }
+            }
+            node_begin[dense.size()] = next;
+            node_count.store(dense.size(), std::memory_order_release);
+        }
+
+        static bool cpulist_contains(std::string const &list, unsigned cpu) {
+            std::size_t pos = 0;
+            while (pos < list.size()) {
+                auto end = list.find(',', pos);
+                auto range = list.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+                auto dash = range.find('-');
+                auto first = std::stoul(range.substr(0, dash));
+                auto last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+                if (cpu >= first && cpu <= last) {
+                    return true;
+                }
+                if (end == std::string::npos) {
+                    break;
+                }
+                pos = end + 1;
+            }
+            return false;
+        }
+
+        // The node of the CPU this shard runs on, read from sysfs. Shards are pinned to their CPU unless seastar runs
+        // with --thread-affinity=0.
+        static unsigned local_node() {
+            auto cpu = sched_getcpu();
+            if (cpu < 0) {
+                return 0;
+            }
+            for (unsigned node = 0; node < max_numa_nodes; ++node) {
+                std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                std::string list;
+                if (file && std::getline(file, list) && !list.empty() && cpulist_contains(list, cpu)) {
+                    return node;
+                }
+            }
+            return 0;
+        }
+    };
+
+    /// Shard selection that spreads the messages of a [ultramarine::local_actor]() over the shards of the sender's NUMA
+    /// node in turn. Shards of other nodes are only used when no shard of the sender's node may host an activation.
+    /// Combined with a [ultramarine::shard_set](), only the shards of the set that are on the sender's node are used.
+    struct numa_local_shard_selection {
+        static constexpr bool tracks_load = false;
+
+        template<typename Actor>
+        static seastar::shard_id select(seastar::shard_id count) noexcept {
+            auto node = numa_topology::node_of(seastar::engine().cpu_id());
+            auto size = numa_topology::node_size(node);
+            for (seastar::shard_id attempt = 0; attempt < size; ++attempt) {
+                auto shard = numa_topology::shard_at(node, Actor::round_robin_counter++ % size);
+                if (hosting_index<Actor>(shard) < count) {
+                    return shard;
+                }
+            }
+            return round_robin_shard_selection::select<Actor>(count);
+        }
+    };
+}
+
+namespace ultramarine {
+
+    /// Read the NUMA node of every shard from the system
+    /// \effects Each shard looks up the node of the CPU it runs on. NUMA-aware placement strategies and shard
+    /// selections use the result once the returned future is available
+    /// \returns A future available once the topology is known on every shard
+    /// \notes Call it once at startup, before any actor using a NUMA-aware strategy is referenced, since placements
+    /// depend on it. Without it, every shard is considered to be on the same node
+    inline seastar::future<> discover_numa_topology() {
+        return seastar::map_reduce(boost::irange<seastar::shard_id>(0, seastar::smp::count), [](auto shard) {
+            return seastar::smp::submit_to(shard, [shard] {
+                return std::make_pair(shard, impl::numa_topology::local_node());
+            });
+        }, std::vector<unsigned>(seastar::smp::count), [](std::vector<unsigned> nodes, auto node) {
+            nodes[node.first] = node.second;
+            return nodes;
+        }).then([](std::vector<unsigned> nodes) {
+            impl::numa_topology::set(nodes);
+        });
+    }
+
+    /// Set the NUMA node of every shard explicitly, for instance to simulate a multi-socket machine
+    /// \param nodes The node of each shard, indexed by shard id. Ignored unless it holds one entry per shard
+    /// \notes Like [ultramarine::discover_numa_topology](), it must be called before any actor using a NUMA-aware
+    /// strategy is referenced
+    inline void set_numa_topology(std::vector<unsigned> const &nodes) {
+        impl::numa_topology::set(nodes);
+    }
+}
@@ -0,0 +1,195 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/lowres_clock.hh>
+#include <seastar/core/sleep.hh>
+#include <ultramarine/impl/actor_traits.hpp>
+#include "deactivation.hpp"
+
+namespace ultramarine::impl {
+
+    template<typename Actor>
+    struct actor_directory;
+
+    // Spreads the messages a shard receives for a pooled local actor over several activations.
+    // A message goes to an activation with nothing in flight, or to a new one while the pool is below
+    // Actor::pool_max_activations, or else to the activation with the fewest messages in flight. Activations above
+    // Actor::pool_min_activations are destroyed once idle for Actor::pool_idle_timeout, through on_deactivate() for
+    // deactivatable actors. The first Actor::pool_min_activations activations of a pool are the ones kept, so a pool
+    // back at its minimum with nothing in flight is forgotten: it is rebuilt with the same activations when needed.
+    template<typename Actor>
+    struct pool_service {
+        static_assert(is_local_actor_v<Actor>, "Activation pools require a local_actor");
+
+        struct slot {
+            std::size_t id;
+            std::size_t generation;
+            std::size_t inflight = 0;
+            seastar::lowres_clock::time_point idle_since = seastar::lowres_clock::now();
+        };
+
+        struct pool {
+            std::vector<slot> slots;
+            std::size_t generation = 0;
+        };
+
+        static inline thread_local std::unordered_map<std::size_t, pool> pools;
+        static inline thread_local bool reaper_running = false;
+
+        template<typename Handler, typename ...Args>
+        using dispatch_future = seastar::futurize_t<decltype(actor_directory<Actor>::dispatch_message_impl(
+                std::declval<Actor *>(), std::declval<Handler>(), std::declval<Args>() ...))>;
+
+        // The first activation of a pool keeps the id of the pool, so a pool of one behaves like a plain local actor
+        static std::size_t slot_id(std::size_t id, std::size_t generation) noexcept {
+            return generation ? id ^ (0x9e3779b97f4a7c15ULL * generation) : id;
+        }
+
+        static void grow(pool &p, std::size_t id) {
+            p.slots.push_back(slot{slot_id(id, p.generation), p.generation});
+            ++p.generation;
+        }
+
+        static bool at_rest(pool const &p) noexcept {
+            return p.slots.size() <= Actor::pool_min_activations
+                   && std::none_of(std::begin(p.slots), std::end(p.slots), [](auto const &s) { return s.inflight; });
+        }
+
+        static std::size_t pick(std::size_t id) {
+            auto[it, created] = pools.try_emplace(id);
+            if (created) {
+                start_reaper();
+            }
+            auto &p = it->second;
+            while (p.slots.size() < Actor::pool_min_activations) {
+                grow(p, id);
+            }
+            std::size_t best = 0;
+            for (std::size_t i = 0; i < p.slots.size(); ++i) {
+                if (!p.slots[i].inflight) {
+                    return p.slots[i].id;
+                }
+                if (p.slots[i].inflight < p.slots[best].inflight) {
+                    best = i;
+                }
+            }
+            if (p.slots.size() < Actor::pool_max_activations) {
+                grow(p, id);
+                return p.slots.back().id;
+            }
+            return p.slots[best].id;
+        }
+
+        static slot *find(std::size_t id, std::size_t activation) noexcept {
+            if (auto it = pools.find(id); it != pools.end()) {
+                for (auto &s : it->second.slots) {
+                    if (s.id == activation) {
+                        return &s;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        template<typename KeyType>
+        static Actor *acquire(KeyType &&key, std::size_t id, std::size_t activation) {
+            ++find(id, activation)->inflight;
+            return actor_directory<Actor>::hold_activation(std::forward<KeyType>(key), activation);
+        }
+
+        static void release(std::size_t id, std::size_t activation) noexcept {
+            if (auto s = find(id, activation); s && !--s->inflight) {
+                s->idle_since = seastar::lowres_clock::now();
+            }
+        }
+
+        template<typename KeyType, typename Handler, typename ...Args>
+        static dispatch_future<Handler, Args...> dispatch(KeyType &&key, std::size_t id, Handler message,
+                                                          Args &&... args) {
+            auto activation = pick(id);
+            auto act = acquire(std::forward<KeyType>(key), id, activation);
+            return seastar::futurize_apply([act, message](auto &&... args) {
+                return actor_directory<Actor>::dispatch_message_impl(act, message,
+                                                                     std::forward<decltype(args)>(args) ...);
+            }, std::forward<Args>(args) ...).finally([id, activation] {
+                release(id, activation);
+            });
+        }
+
+        template<typename KeyType, typename Handler, typename Arguments>
+        static auto dispatch_packed(KeyType &&key, std::size_t id, Handler message, Arguments &&args) {
+            auto activation = pick(id);
+            auto act = acquire(std::forward<KeyType>(key), id, activation);
+            return actor_directory<Actor>::dispatch_packed_activation(act, message, std::move(args)).finally(
+                    [id, activation] {
+                        release(id, activation);
+                    });
+        }
+
+        // Destroys the idle activations above the minimum, and forgets the pools at rest. Returns whether pools remain.
+        static bool shrink() {
+            auto now = seastar::lowres_clock::now();
+            for (auto entry = std::begin(pools); entry != std::end(pools);) {
+                auto &p = entry->second;
+                for (auto it = std::begin(p.slots); it != std::end(p.slots)
+                                                    && p.slots.size() > Actor::pool_min_activations;) {
+                    if (it->inflight || it->generation < Actor::pool_min_activations
+                        || now - it->idle_since < Actor::pool_idle_timeout) {
+                        ++it;
+                        continue;
+                    }
+                    if constexpr (is_deactivatable_v<Actor>) {
+                        (void) deactivation_service<Actor>::deactivate(it->id).handle_exception(
+                                [](std::exception_ptr) {});
+                    } else if (Actor::directory) {
+                        Actor::directory->erase(it->id);
+                    }
+                    it = p.slots.erase(it);
+                }
+                entry = at_rest(p) ? pools.erase(entry) : std::next(entry);
+            }
+            return !pools.empty();
+        }
+
+        static void start_reaper() {
+            if (reaper_running) {
+                return;
+            }
+            reaper_running = true;
+            (void) seastar::sleep<seastar::lowres_clock>(Actor::pool_idle_timeout).then([] {
+                reaper_running = false;
+                if (shrink()) {
+                    start_reaper();
+                }
+            });
+        }
+    };
+}
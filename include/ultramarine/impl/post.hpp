@@ -0,0 +1,77 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <seastar/core/future.hh>
+#include <seastar/core/future-util.hh>
+#include <seastar/util/log.hh>
+#include "coalescer.hpp"
+
+namespace ultramarine::impl {
+
+    inline seastar::logger post_logger("ultramarine");
+
+    template<typename Actor, typename = void>
+    struct has_on_post_error : std::false_type {
+    };
+
+    template<typename Actor>
+    struct has_on_post_error<Actor, std::void_t<decltype(Actor::on_post_error(std::declval<std::exception_ptr>()))>>
+            : std::true_type {
+    };
+
+    // Posted messages have no caller to report to: failures go to Actor::on_post_error if declared, or to the log
+    template<typename Actor>
+    inline void report_post_error(std::exception_ptr ex) noexcept {
+        if constexpr (has_on_post_error<Actor>::value) {
+            Actor::on_post_error(std::move(ex));
+        } else {
+            post_logger.warn("posted message failed: {}", ex);
+        }
+    }
+
+    template<typename Actor, typename Func>
+    inline seastar::future<> run_posted(Func &&func) noexcept {
+        return seastar::futurize_apply(std::forward<Func>(func)).then_wrapped([](auto &&f) {
+            if (f.failed()) {
+                report_post_error<Actor>(f.get_exception());
+            } else {
+                f.ignore_ready_future();
+            }
+        });
+    }
+
+    // Coalescing settings shared by every posted message. Posted messages carry no promise: the only reply is the
+    // acknowledgement of the whole batch by seastar's cross-shard queue. A batch is flushed when it holds
+    // coalescing_batch_size messages or once the tasks currently queued on the reactor have run.
+    struct post_coalescing {
+        static constexpr std::size_t coalescing_batch_size = 128;
+        static constexpr std::chrono::microseconds coalescing_flush_deadline = std::chrono::microseconds(0);
+    };
+
+    using outbound_post_queue = outbound_coalescer<post_coalescing>;
+}
@@ -0,0 +1,118 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+#include <seastar/core/future-util.hh>
+#include <seastar/core/reactor.hh>
+#include <seastar/core/scheduling.hh>
+
+namespace ultramarine {
+
+    namespace impl {
+        struct scheduled_actor {
+        };
+
+        // The seastar group of each group type, as known by this shard. Groups are created once for all shards, then
+        // published to each of them. Until then, it is the default group.
+        template<typename Group>
+        struct scheduling_groups {
+            static inline thread_local seastar::scheduling_group group{};
+        };
+
+        template<typename Handler, typename = void>
+        struct handler_of {
+            using type = Handler;
+        };
+
+        // Batched and forwarded messages are scheduled like the message they wrap
+        template<typename Handler>
+        struct handler_of<Handler, std::void_t<decltype(std::declval<Handler>().handler)>> {
+            using type = decltype(std::declval<Handler>().handler);
+        };
+
+        template<typename Actor, typename Handler, typename = void>
+        struct message_group {
+            using type = void;
+        };
+
+        template<typename Actor, typename Handler>
+        struct message_group<Actor, Handler, std::void_t<decltype(Actor::scheduling_group_of(
+                std::declval<typename handler_of<Handler>::type>()))>> {
+            using type = decltype(Actor::scheduling_group_of(std::declval<typename handler_of<Handler>::type>()));
+        };
+
+        template<typename Actor, typename = void>
+        struct actor_group {
+            using type = void;
+        };
+
+        template<typename Actor>
+        struct actor_group<Actor, std::enable_if_t<std::is_base_of_v<scheduled_actor, Actor>>> {
+            using type = typename Actor::scheduling_group_type;
+        };
+
+        // A message declared in a group of its own runs there. Others run in the group of their actor type, if any.
+        template<typename Actor, typename Handler>
+        using scheduling_group_t = std::conditional_t<std::is_void_v<typename message_group<Actor, Handler>::type>,
+                typename actor_group<Actor>::type, typename message_group<Actor, Handler>::type>;
+
+        template<typename Actor, typename Handler>
+        constexpr bool is_scheduled_message_v = !std::is_void_v<scheduling_group_t<Actor, Handler>>;
+
+        template<typename Actor, typename Handler>
+        seastar::scheduling_group scheduling_group_of() noexcept {
+            return scheduling_groups<scheduling_group_t<Actor, Handler>>::group;
+        }
+    }
+
+    /// Create the seastar scheduling group described by the `Group` type
+    /// \requires Type `Group` shall declare a `static constexpr char const *name` and a `static constexpr float
+    /// shares` members
+    /// \effects Messages of the actor types and messages assigned to `Group` run in the new group once the returned
+    /// future is available. Until then, they run in the default group
+    /// \returns A future available once the group exists on every shard
+    /// \notes Call it once at startup, from a single shard. Seastar supports a limited number of scheduling groups
+    template<typename Group>
+    seastar::future<> create_scheduling_group() {
+        return seastar::create_scheduling_group(Group::name, Group::shares).then([](seastar::scheduling_group group) {
+            return seastar::smp::invoke_on_all([group] {
+                impl::scheduling_groups<Group>::group = group;
+            });
+        });
+    }
+
+    /// Change the shares of the scheduling group described by the `Group` type
+    /// \param shares The new shares of the group, relative to the shares of the other groups
+    /// \returns A future available once the shares are changed on every shard
+    /// \requires The group shall be created with [ultramarine::create_scheduling_group]()
+    template<typename Group>
+    seastar::future<> set_scheduling_group_shares(float shares) {
+        return seastar::smp::invoke_on_all([shares] {
+            impl::scheduling_groups<Group>::group.set_shares(shares);
+        });
+    }
+}
@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <seastar/core/reactor.hh>
+#include "shard_set.hpp"
+
+namespace ultramarine::impl {
+
+    /// The number of shards whose load is tracked separately. Shards beyond it share counters.
+    static constexpr std::size_t max_tracked_shards = 256;
+
+    // One counter per shard and per actor type, each on its own cache line. Senders increment the counter of the
+    // shard they pick and decrement it once the reply is back, so it also covers messages still queued on that shard.
+    template<typename Actor>
+    struct shard_load {
+        struct alignas(64) counter {
+            std::atomic<std::uint32_t> inflight{0};
+        };
+
+        static inline std::array<counter, max_tracked_shards> counters;
+
+        static std::atomic<std::uint32_t> &of(seastar::shard_id shard) noexcept {
+            return counters[shard % max_tracked_shards].inflight;
+        }
+
+        [[nodiscard]] static std::uint32_t depth(seastar::shard_id shard) noexcept {
+            return of(shard).load(std::memory_order_relaxed);
+        }
+
+        static void acquire(seastar::shard_id shard) noexcept {
+            of(shard).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        static void release(seastar::shard_id shard) noexcept {
+            of(shard).fetch_sub(1, std::memory_order_relaxed);
+        }
+    };
+
+    /// Shard selection that spreads the messages of a [ultramarine::local_actor]() over the shards in turn, starting
+    /// from the shard of the sender
+    struct round_robin_shard_selection {
+        static constexpr bool tracks_load = false;
+
+        template<typename Actor>
+        static seastar::shard_id select(seastar::shard_id count) noexcept {
+            return hosting_shard<Actor>((Actor::round_robin_counter++ + seastar::engine().cpu_id()) % count);
+        }
+    };
+
+    /// Shard selection that sends each message of a [ultramarine::local_actor]() to the least busy of two candidate
+    /// shards, based on the number of messages in flight on each of them. The first candidate is the shard of the
+    /// sender when it may host an activation, and wins ties. The second is drawn at random among the others.
+    struct least_loaded_shard_selection {
+        static constexpr bool tracks_load = true;
+
+        template<typename Actor>
+        static seastar::shard_id select(seastar::shard_id count) noexcept {
+            static thread_local std::uint64_t state = 0x9e3779b97f4a7c15ULL * (seastar::engine().cpu_id() + 1);
+            if (count == 1) {
+                return hosting_shard<Actor>(0);
+            }
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            auto local = hosting_index<Actor>(seastar::engine().cpu_id());
+            seastar::shard_id first = local < count ? local : state % count;
+            seastar::shard_id second = (state >> 32) % (count - 1);
+            second += second >= first;
+            first = hosting_shard<Actor>(first);
+            second = hosting_shard<Actor>(second);
+            return shard_load<Actor>::depth(second) < shard_load<Actor>::depth(first) ? second : first;
+        }
+    };
+}
@@ -0,0 +1,179 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <seastar/core/reactor.hh>
+
+namespace ultramarine {
+
+    namespace impl {
+        /// The number of shards a shard set may name
+        static constexpr std::size_t max_shard_set_size = 256;
+
+        struct shard_set_actor {
+        };
+    }
+
+    /// A set of shards chosen at runtime, identified by the `Tag` type
+    /// \unique_name ultramarine::shard_set
+    /// \tparam Tag Any type, naming the set
+    /// \notes Until [ultramarine::assign_shards]() is called for `Tag`, the set holds every shard. Shards are assigned
+    /// once at startup, before any actor restricted to the set is referenced, since placements depend on them. Later
+    /// assignments are ignored.
+    template<typename Tag>
+    struct shard_set {
+        /// \exclude
+        static inline std::array<std::uint16_t, impl::max_shard_set_size> shards{};
+
+        /// \exclude
+        static inline std::vector<std::uint16_t> positions;
+
+        /// \exclude
+        static inline std::atomic<seastar::shard_id> size{0};
+
+        /// \exclude
+        static inline std::atomic<bool> assigned{false};
+
+        /// \returns The number of shards in the set
+        [[nodiscard]] static seastar::shard_id count() noexcept {
+            auto n = size.load(std::memory_order_acquire);
+            return n ? n : seastar::smp::count;
+        }
+
+        /// \returns The shard at position `index` in the set
+        [[nodiscard]] static seastar::shard_id at(seastar::shard_id index) noexcept {
+            return size.load(std::memory_order_acquire) ? shards[index] : index;
+        }
+
+        /// \returns The position of `shard` in the set, or `count()` if it is not part of it
+        [[nodiscard]] static seastar::shard_id index_of(seastar::shard_id shard) noexcept {
+            auto n = size.load(std::memory_order_acquire);
+            if (!n) {
+                return shard;
+            }
+            return shard < positions.size() ? std::min<seastar::shard_id>(positions[shard], n) : n;
+        }
+    };
+
+    /// A fixed range of shards, from `First` to `Last` included
+    /// \unique_name ultramarine::shard_range
+    /// \notes The range is clamped to the shards that exist. If `First` is not one of them, the range holds the last
+    /// shard only.
+    template<seastar::shard_id First, seastar::shard_id Last>
+    struct shard_range {
+        static_assert(First <= Last, "Shard range bounds are inverted");
+
+        /// \exclude
+        [[nodiscard]] static seastar::shard_id first() noexcept {
+            return std::min(First, seastar::smp::count - 1);
+        }
+
+        /// \returns The number of shards in the range
+        [[nodiscard]] static seastar::shard_id count() noexcept {
+            return std::min(Last, seastar::smp::count - 1) - first() + 1;
+        }
+
+        /// \returns The shard at position `index` in the range
+        [[nodiscard]] static seastar::shard_id at(seastar::shard_id index) noexcept {
+            return first() + index;
+        }
+
+        /// \returns The position of `shard` in the range, or `count()` if it is not part of it
+        [[nodiscard]] static seastar::shard_id index_of(seastar::shard_id shard) noexcept {
+            return shard >= first() && shard - first() < count() ? shard - first() : count();
+        }
+    };
+
+    /// Assign shards to the [ultramarine::shard_set]() named `Tag`
+    /// \param shards The shards of the set. Shards that do not exist are ignored, and so are repeated ones
+    /// \effects If no given shard exists, or if the set was already assigned, the set is left unchanged. Shards read
+    /// the set without synchronization, so it is only ever written once
+    /// \returns Whether the set was assigned by this call
+    template<typename Tag>
+    bool assign_shards(std::vector<seastar::shard_id> const &shards) {
+        constexpr auto absent = std::numeric_limits<std::uint16_t>::max();
+        if (shard_set<Tag>::assigned.load(std::memory_order_acquire)) {
+            return false;
+        }
+        std::vector<std::uint16_t> positions(seastar::smp::count, absent);
+        std::array<seastar::shard_id, impl::max_shard_set_size> order{};
+        std::size_t n = 0;
+        for (auto shard : shards) {
+            if (shard < seastar::smp::count && positions[shard] == absent && n < impl::max_shard_set_size) {
+                positions[shard] = static_cast<std::uint16_t>(n);
+                order[n++] = shard;
+            }
+        }
+        if (!n || shard_set<Tag>::assigned.exchange(true, std::memory_order_acq_rel)) {
+            return false;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            shard_set<Tag>::shards[i] = static_cast<std::uint16_t>(order[i]);
+        }
+        shard_set<Tag>::positions = std::move(positions);
+        shard_set<Tag>::size.store(n, std::memory_order_release);
+        return true;
+    }
+
+    namespace impl {
+        template<typename Actor>
+        constexpr bool has_shard_set_v = std::is_base_of_v<shard_set_actor, Actor>;
+
+        // Shards hosting an actor type are numbered from zero. Without a shard set, the number of a shard is its id.
+        template<typename Actor>
+        seastar::shard_id hosting_count() noexcept {
+            if constexpr (has_shard_set_v<Actor>) {
+                return Actor::shard_set::count();
+            } else {
+                return seastar::smp::count;
+            }
+        }
+
+        template<typename Actor>
+        seastar::shard_id hosting_shard(seastar::shard_id index) noexcept {
+            if constexpr (has_shard_set_v<Actor>) {
+                return Actor::shard_set::at(index);
+            } else {
+                return index;
+            }
+        }
+
+        template<typename Actor>
+        seastar::shard_id hosting_index(seastar::shard_id shard) noexcept {
+            if constexpr (has_shard_set_v<Actor>) {
+                return Actor::shard_set::index_of(shard);
+            } else {
+                return shard;
+            }
+        }
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <seastar/core/future.hh>
+#include <seastar/core/shared_future.hh>
+#include "handoff.hpp"
+#include "key_hash.hpp"
+
+namespace ultramarine::impl {
+
+    // Arguments identifying a request must be hashed and compared. Handed-off payloads are never shared.
+    template<typename T, typename = void>
+    struct is_flight_key : std::bool_constant<std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T> ||
+                                              std::is_convertible_v<T const &, std::string_view>> {
+    };
+
+    template<typename T>
+    struct is_flight_key<T, std::enable_if_t<std::is_default_constructible_v<std::hash<T>> && !is_handoff<T>::value>>
+            : std::true_type {
+    };
+
+    template<typename ...Args>
+    constexpr bool is_flight_key_v = (is_flight_key<std::decay_t<Args>>::value && ...);
+
+    struct flight_hasher {
+        template<typename ...Keys>
+        std::size_t operator()(std::tuple<Keys...> const &key) const noexcept {
+            return std::apply([](Keys const &... values) {
+                std::uint64_t hash = hash_secret[2];
+                ((hash = hash_mum(hash ^ default_key_hasher{}(values), hash_secret[3])), ...);
+                return static_cast<std::size_t>(hash);
+            }, key);
+        }
+    };
+
+    template<typename Future>
+    struct shared_future_of;
+
+    template<typename ...T>
+    struct shared_future_of<seastar::future<T...>> {
+        using type = seastar::shared_future<T...>;
+    };
+
+    // Identical requests in flight on this shard, for one message type. A request joining one in flight gets a copy
+    // of its result instead of running again. The entry is removed once the result is available, so later requests
+    // run again and observe later states.
+    template<typename Tag, typename Future, typename ...Keys>
+    struct single_flight {
+        using key_type = std::tuple<Keys...>;
+        using shared_type = typename shared_future_of<Future>::type;
+
+        static inline thread_local std::unordered_map<key_type, shared_type, flight_hasher> in_flight;
+
+        template<typename Func>
+        static Future join(key_type key, Func &&func) {
+            if (auto it = in_flight.find(key); it != in_flight.end()) {
+                return it->second.get_future();
+            }
+            Future f = func();
+            if (f.available()) {
+                return f;
+            }
+            shared_type shared(f.finally([key] {
+                in_flight.erase(key);
+            }));
+            in_flight.emplace(std::move(key), shared);
+            return shared.get_future();
+        }
+    };
+}
@@ -0,0 +1,207 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <seastar/core/future.hh>
+#include <seastar/core/reactor.hh>
+#include <ultramarine/impl/actor_traits.hpp>
+#include "coalescer.hpp"
+#include "shard_selection.hpp"
+
+namespace ultramarine::impl {
+
+    // Per-shard run queue of the messages sent to a work stealing local actor. Messages are created on the sending
+    // shard like coalesced messages, queued on the shard picked by the actor_ref, and dispatched by whichever shard
+    // dequeues them. Their result always travels back to the sending shard.
+    // A shard that runs out of work takes up to Actor::steal_batch_size messages from the tail of the longest queue
+    // among the shards allowed to host an activation. Queue lengths are published through shard_load.
+    template<typename Actor>
+    class work_stealing_queue {
+        static_assert(is_local_actor_v<Actor>, "Work stealing requires a local_actor");
+
+        struct entry {
+            coalesced_message *msg;
+            seastar::shard_id source;
+        };
+
+        using load = shard_load<work_stealing_queue<Actor>>;
+
+        static inline thread_local std::deque<entry> pending;
+        static inline thread_local std::size_t running = 0;
+        static inline thread_local bool drain_scheduled = false;
+        static inline thread_local bool stealing = false;
+        static inline thread_local bool hint_pending = false;
+
+        static seastar::shard_id hosts() noexcept {
+            return std::min<std::size_t>(hosting_count<Actor>(), Actor::max_activations);
+        }
+
+        static void publish() noexcept {
+            load::of(seastar::engine().cpu_id()).store(pending.size(), std::memory_order_relaxed);
+        }
+
+        static bool idle() noexcept {
+            return pending.empty() && !running;
+        }
+
+        static void complete(entry e) {
+            if (e.source == seastar::engine().cpu_id()) {
+                std::unique_ptr<coalesced_message>(e.msg)->complete(std::exception_ptr());
+            } else {
+                (void) seastar::smp::submit_to(e.source, [msg = e.msg] {
+                    std::unique_ptr<coalesced_message>(msg)->complete(std::exception_ptr());
+                });
+            }
+        }
+
+        static void schedule_drain() {
+            if (!drain_scheduled) {
+                drain_scheduled = true;
+                (void) seastar::later().then([] {
+                    drain_scheduled = false;
+                    drain();
+                });
+            }
+        }
+
+        static void drain() {
+            while (running < Actor::worker_concurrency && !pending.empty()) {
+                if (seastar::need_preempt()) {
+                    schedule_drain();
+                    return;
+                }
+                auto e = pending.front();
+                pending.pop_front();
+                publish();
+
+                ++running;
+                auto f = e.msg->dispatch();
+                if (f.available()) {
+                    f.ignore_ready_future();
+                    --running;
+                    complete(e);
+                } else {
+                    (void) f.then_wrapped([e](auto &&f) {
+                        f.ignore_ready_future();
+                        --running;
+                        complete(e);
+                        drain();
+                    });
+                }
+            }
+            if (idle()) {
+                steal();
+            }
+        }
+
+        static std::vector<entry> take(std::size_t max) {
+            auto count = std::min(max, pending.size() / 2);
+            std::vector<entry> stolen(std::end(pending) - count, std::end(pending));
+            pending.erase(std::end(pending) - count, std::end(pending));
+            publish();
+            return stolen;
+        }
+
+        static void steal() {
+            auto here = seastar::engine().cpu_id();
+            if (stealing || hosting_index<Actor>(here) >= hosts()) {
+                return;
+            }
+            seastar::shard_id victim = here;
+            std::uint32_t longest = 1;
+            for (seastar::shard_id index = 0; index < hosts(); ++index) {
+                auto shard = hosting_shard<Actor>(index);
+                if (shard != here && load::depth(shard) > longest) {
+                    victim = shard;
+                    longest = load::depth(shard);
+                }
+            }
+            if (victim == here) {
+                return;
+            }
+            stealing = true;
+            (void) seastar::smp::submit_to(victim, [] {
+                return take(Actor::steal_batch_size);
+            }).then_wrapped([](auto &&f) {
+                stealing = false;
+                if (!f.failed()) {
+                    for (auto &e : f.get0()) {
+                        pending.push_back(e);
+                    }
+                    publish();
+                }
+                f.ignore_ready_future();
+                drain();
+            });
+        }
+
+        // Wakes up an idle peer when this queue grows, since idle shards only steal when their own work runs out
+        static void hint_idle_peer() {
+            if (hint_pending) {
+                return;
+            }
+            auto here = seastar::engine().cpu_id();
+            for (seastar::shard_id index = 0; index < hosts(); ++index) {
+                auto shard = hosting_shard<Actor>(index);
+                if (shard != here && !load::depth(shard)) {
+                    hint_pending = true;
+                    (void) seastar::smp::submit_to(shard, [] {
+                        if (idle()) {
+                            steal();
+                        }
+                    }).finally([] {
+                        hint_pending = false;
+                    });
+                    return;
+                }
+            }
+        }
+
+        static void enqueue(entry e) {
+            pending.push_back(e);
+            publish();
+            schedule_drain();
+            if (pending.size() >= 2 * Actor::steal_batch_size) {
+                hint_idle_peer();
+            }
+        }
+
+    public:
+        template<typename Func>
+        static auto submit(seastar::shard_id dest, Func &&func) {
+            auto msg = std::make_unique<coalesced_message_impl<std::decay_t<Func>>>(std::forward<Func>(func));
+            auto fut = msg->get_future();
+            (void) seastar::smp::submit_to(dest, [e = entry{msg.release(), seastar::engine().cpu_id()}] {
+                enqueue(e);
+            });
+            return fut;
+        }
+    };
+}
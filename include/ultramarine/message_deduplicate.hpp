@@ -24,12 +24,74 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
 #include <seastar/core/future.hh>
+#include <seastar/core/semaphore.hh>
+#include <seastar/core/shared_future.hh>
+#include <seastar/core/temporary_buffer.hh>
 #include "ultramarine/actor_ref.hpp"
 #include "ultramarine/impl/arguments_vector.hpp"
 
 namespace ultramarine {
 
+    /// Chunking and flow control parameters of [ultramarine::deduplicate_stream]()
+    /// \unique_name ultramarine::stream_options
+    struct stream_options {
+        /// The number of calls after which a chunk is sent
+        std::size_t chunk_size = 4096;
+        /// The size in bytes of the packed arguments, as measured by [ultramarine::payload_size](), after which a chunk
+        /// is sent
+        std::size_t chunk_bytes = 1024 * 1024;
+        /// The number of chunks that can be pending before the producer has to wait
+        std::size_t max_in_flight = 4;
+    };
+
+    /// Measures the bytes a message argument adds to a chunk of [ultramarine::deduplicate_stream]()
+    /// \unique_name ultramarine::payload_size
+    /// \notes The default counts `sizeof(T)` only. Specialize it for types owning heap storage so that
+    /// `stream_options::chunk_bytes` accounts for it.
+    template<typename T>
+    struct payload_size {
+        static std::size_t of(T const &) noexcept {
+            return sizeof(T);
+        }
+    };
+
+    template<typename CharType, typename Traits, typename Allocator>
+    struct payload_size<std::basic_string<CharType, Traits, Allocator>> {
+        static std::size_t of(std::basic_string<CharType, Traits, Allocator> const &value) noexcept {
+            return sizeof(value) + std::size(value) * sizeof(CharType);
+        }
+    };
+
+    template<typename T, typename Allocator>
+    struct payload_size<std::vector<T, Allocator>> {
+        static std::size_t of(std::vector<T, Allocator> const &value) noexcept {
+            if constexpr (std::is_arithmetic_v<T>) {
+                return sizeof(value) + std::size(value) * sizeof(T);
+            } else {
+                std::size_t size = sizeof(value);
+                for (auto const &item : value) {
+                    size += payload_size<T>::of(item);
+                }
+                return size;
+            }
+        }
+    };
+
+    template<typename CharType>
+    struct payload_size<seastar::temporary_buffer<CharType>> {
+        static std::size_t of(seastar::temporary_buffer<CharType> const &value) noexcept {
+            return sizeof(value) + std::size(value) * sizeof(CharType);
+        }
+    };
+
     namespace impl {
         template<typename Actor, typename Message, typename... Args>
         class deduplicator {
@@ -54,6 +116,131 @@ namespace ultramarine {
             }
         };
 
+        template<typename Actor, typename Message, typename... Args>
+        class streaming_deduplicator {
+            using packed_type = arguments_vector<std::tuple<Args...>>;
+            using chunk_future = decltype(std::declval<actor_ref <Actor> &>().tell_packed(
+                    std::declval<Message>(), std::declval<packed_type &&>()));
+            using chunk_result = typename get0_return_type<typename chunk_future::value_type>::type;
+            static constexpr bool has_results = !std::is_void_v<chunk_result>;
+
+            Message handler;
+            actor_ref <Actor> ref;
+            stream_options options;
+            packed_type packed;
+            seastar::semaphore inflight;
+            std::vector<std::conditional_t<has_results, chunk_result, std::tuple<>>> results;
+            std::size_t chunks = 0;
+            std::size_t bytes = 0;
+            std::exception_ptr error;
+            // Pending while a full chunk waits for an in-flight slot. Calls made meanwhile wait for it too and keep
+            // filling the next chunk, so at most one chunk is ever queued behind the in-flight ones.
+            std::optional<seastar::shared_future<>> admission;
+
+            [[nodiscard]] bool full() const noexcept {
+                return std::size(packed) >= options.chunk_size || bytes >= options.chunk_bytes;
+            }
+
+            seastar::future<> flush() {
+                if (std::size(packed) == 0) {
+                    return seastar::make_ready_future();
+                }
+                auto index = chunks++;
+                if constexpr (has_results) {
+                    results.emplace_back();
+                }
+                auto chunk = std::exchange(packed, packed_type());
+                bytes = 0;
+                if constexpr (sizeof...(Args) > 0) {
+                    packed.reserve(std::size(chunk));
+                }
+                admission = seastar::shared_future<>(seastar::get_units(inflight, 1).then(
+                        [this, index, chunk = std::move(chunk)](auto units) mutable {
+                    (void) ref.tell_packed(handler, std::move(chunk)).then_wrapped(
+                            [this, index, units = std::move(units)](auto &&f) mutable {
+                                if (f.failed()) {
+                                    auto ex = f.get_exception();
+                                    if (!error) {
+                                        error = std::move(ex);
+                                    }
+                                } else if constexpr (has_results) {
+                                    results[index] = f.get0();
+                                }
+                            });
+                }));
+                return admission->get_future();
+            }
+
+            [[nodiscard]] bool queued() const noexcept {
+                return admission && !admission->available();
+            }
+
+        public:
+            streaming_deduplicator(Message handler, actor_ref <Actor> &ref, stream_options options) :
+                    handler(handler), ref(ref), options(options),
+                    inflight(std::max<std::size_t>(options.max_in_flight, 1)) {
+                if constexpr (sizeof...(Args) > 0) {
+                    packed.reserve(std::min(options.chunk_size, options.chunk_bytes / sizeof(std::tuple<Args...>) + 1));
+                }
+            }
+
+            template<typename ...TArgs>
+            inline seastar::future<> operator()(TArgs &&... args) {
+                packed.emplace_back(std::make_tuple(std::forward<TArgs>(args) ...));
+                if constexpr (sizeof...(Args) > 0) {
+                    bytes += std::apply([](auto const &... args) {
+                        return (std::size_t(0) + ... + payload_size<std::decay_t<decltype(args)>>::of(args));
+                    }, packed.back());
+                } else {
+                    bytes += sizeof(std::tuple<>);
+                }
+                if (queued()) {
+                    return admission->get_future().then([this] {
+                        return full() && !queued() ? flush() : seastar::make_ready_future();
+                    });
+                }
+                return full() ? flush() : seastar::make_ready_future();
+            }
+
+            /// Wait for every chunk, including the last partial one, to be processed
+            inline auto execute(std::exception_ptr producer_error = nullptr) {
+                if (producer_error) {
+                    error = std::move(producer_error);
+                }
+                auto pending = queued() ? admission->get_future() : seastar::make_ready_future();
+                return pending.then([this] {
+                    return flush();
+                }).then([this] {
+                    return seastar::get_units(inflight, std::max<std::size_t>(options.max_in_flight, 1));
+                }).then([this](auto) {
+                    if (error) {
+                        return seastar::futurize<chunk_result>::make_exception_future(error);
+                    }
+                    if constexpr (has_results) {
+                        chunk_result ret;
+                        for (auto &chunk : results) {
+                            std::move(std::begin(chunk), std::end(chunk), std::back_inserter(ret));
+                        }
+                        return seastar::make_ready_future<chunk_result>(std::move(ret));
+                    } else {
+                        return seastar::make_ready_future<>();
+                    }
+                });
+            }
+        };
+
+        template<typename Actor, typename Message, typename Return, typename... Args>
+        static auto deduplicate_stream(actor_ref <Actor> ref, Message handler, stream_options options,
+                                       Return(Actor::*)(Args...) const) {
+            return std::make_unique<streaming_deduplicator<Actor, Message, Args...>>(handler, ref, options);
+        }
+
+        template<typename Actor, typename Message, typename Return, typename... Args>
+        static auto deduplicate_stream(actor_ref <Actor> ref, Message handler, stream_options options,
+                                       Return(Actor::*)(Args...)) {
+            return std::make_unique<streaming_deduplicator<Actor, Message, Args...>>(handler, ref, options);
+        }
+
         template<typename Actor, typename Message, typename Return, typename... Args>
         static constexpr auto
         deduplicate(actor_ref <Actor> ref, Message handler, Return(Actor::*)(Args...) const) noexcept {
@@ -74,4 +261,23 @@ namespace ultramarine {
                                     return seastar::futurize<void>::apply(func, d).then([&d] { return d.execute(); });
                                 });
     }
-}
\ No newline at end of file
+
+    /// Stream calls to a message handler as a sequence of bounded packed messages
+    /// \param ref The [ultramarine::actor_ref]() to send the packed messages to
+    /// \param handler The message handler to call
+    /// \param options The chunking and flow control parameters
+    /// \param func A lambda receiving the deduplicator. Each call returns a future that becomes available once the
+    /// arguments are buffered; waiting on it bounds memory to `options.max_in_flight` chunks
+    /// \returns A future available once every chunk has been processed, holding the results in call order if the
+    /// handler returns a value
+    template<typename Actor, typename Message, typename Func>
+    auto deduplicate_stream(actor_ref <Actor> ref, Message handler, stream_options options, Func &&func) {
+        constexpr auto handlerptr = impl::vtable<Actor>::table[handler];
+        return seastar::do_with(impl::deduplicate_stream<Actor, Message>(ref, handler, options, handlerptr),
+                                [func = std::forward<Func>(func)](auto &d) mutable {
+                                    return seastar::futurize_apply(func, *d).then_wrapped([&d](auto &&f) {
+                                        return d->execute(f.failed() ? f.get_exception() : nullptr);
+                                    });
+                                });
+    }
+}
@@ -46,9 +46,7 @@ namespace ultramarine::cluster::impl {
     membership::membership(seastar::socket_address const &local) :
             candidates(100), candidate_connection_job(seastar::make_ready_future()),
             ring(ring_ptr(hash_ring_create(1, HASH_FUNCTION_SHA1), hash_ring_free)), local_node(local) {
-        for (const auto &handler : message_handler_registry()) {
-            handler.second(&proto);
-        }
+        register_message_handlers(proto);
 
         proto.set_logger([](seastar::sstring log) {
             seastar::print("\033[93m%u: RPC -> %s\033[0m\n", seastar::engine().cpu_id(), log);
@@ -37,9 +37,7 @@ namespace ultramarine::cluster::impl {
     }
 
     server::server(seastar::socket_address const &local) : local(local) {
-        for (const auto &handler : message_handler_registry()) {
-            handler.second(&proto);
-        }
+        register_message_handlers(proto);
         proto.register_handler(0, [this](handshake_request req) {
             auto id = make_peer_string_identity(req.origin);
             seastar::print("%u: Received handshake from %s\n", seastar::engine().cpu_id(), id.first);
@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/thread.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+
+class directory_actor : public ultramarine::actor<directory_actor> {
+ULTRAMARINE_DEFINE_ACTOR(directory_actor, (get_key));
+
+public:
+    ultramarine::actor_id get_key() const {
+        return key;
+    }
+};
+
+static thread_local bool fail_activation = false;
+
+struct fragile_state {
+    fragile_state() {
+        if (fail_activation) {
+            throw std::runtime_error("activation failed");
+        }
+    }
+};
+
+class fragile_actor : public ultramarine::actor<fragile_actor> {
+ULTRAMARINE_DEFINE_ACTOR(fragile_actor, (get_key));
+
+public:
+    fragile_state state;
+
+    ultramarine::actor_id get_key() const {
+        return key;
+    }
+};
+
+using namespace seastar;
+
+SEASTAR_THREAD_TEST_CASE (directory_stable_activation_address) {
+    ultramarine::impl::flat_directory<directory_actor> directory;
+    std::unordered_map<ultramarine::actor_id, directory_actor *> activations;
+
+    for (ultramarine::actor_id i = 0; i < 100000; ++i) {
+        activations[i] = directory.try_emplace(i, ultramarine::actor_id(i));
+    }
+
+    BOOST_REQUIRE(directory.size() == activations.size());
+    for (auto &[id, activation] : activations) {
+        BOOST_REQUIRE(directory.find(id) == activation);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (directory_erase) {
+    ultramarine::impl::flat_directory<directory_actor> directory;
+
+    for (ultramarine::actor_id i = 0; i < 1000; ++i) {
+        (void) directory.try_emplace(i, ultramarine::actor_id(i));
+    }
+    for (ultramarine::actor_id i = 0; i < 1000; i += 2) {
+        BOOST_REQUIRE(directory.erase(i));
+    }
+
+    BOOST_REQUIRE(directory.size() == 500);
+    for (ultramarine::actor_id i = 0; i < 1000; ++i) {
+        BOOST_REQUIRE((directory.find(i) != nullptr) == (i % 2 == 1));
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (directory_many_actors) {
+    directory_actor::clear_directory().wait();
+
+    for (ultramarine::actor_id i = 0; i < 10000; ++i) {
+        BOOST_REQUIRE(ultramarine::get<directory_actor>(i).tell(directory_actor::message::get_key()).get0() == i);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (directory_failed_activation_releases_storage) {
+    ultramarine::impl::flat_directory<fragile_actor> directory;
+    auto first = directory.try_emplace(0, ultramarine::actor_id(0));
+
+    fail_activation = true;
+    BOOST_REQUIRE_THROW(directory.try_emplace(1, ultramarine::actor_id(1)), std::runtime_error);
+    fail_activation = false;
+
+    BOOST_REQUIRE(directory.size() == 1);
+    BOOST_REQUIRE(directory.find(1) == nullptr);
+    BOOST_REQUIRE(directory.try_emplace(2, ultramarine::actor_id(2)) == first + 1);
+}
@@ -22,7 +22,9 @@
  * SOFTWARE.
  */
 
+#include <array>
 #include <numeric>
+#include <optional>
 #include <seastar/testing/thread_test_case.hh>
 #include <seastar/core/thread.hh>
 #include <ultramarine/actor_ref.hpp>
@@ -120,4 +122,66 @@ SEASTAR_THREAD_TEST_CASE (key_value_lvref_custom_preserved) {
 
     BOOST_CHECK(counterActor.tell(custom_key_actor::message::get_key()).get0() != custom_key{1});
     BOOST_CHECK(counterActor.tell(custom_key_actor::message::get_key()).get0() == custom_key{0});
-}
\ No newline at end of file
+}
+SEASTAR_THREAD_TEST_CASE (key_ref_compact) {
+#ifndef ULTRAMARINE_REMOTE
+    BOOST_REQUIRE(sizeof(ultramarine::actor_ref<string_actor>) <= 24);
+    BOOST_REQUIRE(sizeof(ultramarine::actor_ref<custom_key_actor>) <= 24);
+#else
+    BOOST_REQUIRE(sizeof(ultramarine::actor_ref<string_actor>) <= 32);
+    BOOST_REQUIRE(sizeof(ultramarine::actor_ref<custom_key_actor>) <= 32);
+#endif
+}
+
+SEASTAR_THREAD_TEST_CASE (key_interned_copy_preserved) {
+    auto counterActor = std::make_optional(ultramarine::get<string_actor>(std::string(64, 'k')));
+    auto copy = *counterActor;
+    counterActor.reset();
+    auto other = ultramarine::get<string_actor>(std::string(64, 'j'));
+
+    BOOST_CHECK(copy.tell(string_actor::message::get_key()).get0() == std::string(64, 'k'));
+    BOOST_CHECK(other.tell(string_actor::message::get_key()).get0() == std::string(64, 'j'));
+}
+
+SEASTAR_THREAD_TEST_CASE (key_interned_foreign_shard_preserved) {
+    auto counterActor = ultramarine::get<string_actor>(std::string(64, 'f'));
+    auto shard = (seastar::engine().cpu_id() + 1) % seastar::smp::count;
+
+    auto key = seastar::smp::submit_to(shard, [counterActor] {
+        auto copy = counterActor;
+        return copy.tell(string_actor::message::get_key());
+    }).get0();
+
+    BOOST_CHECK(key == std::string(64, 'f'));
+}
+
+SEASTAR_THREAD_TEST_CASE (key_hash_strided_spread) {
+    static constexpr std::size_t shards = 8;
+    std::array<std::size_t, shards> placed{};
+
+    for (std::size_t i = 0; i < 8000; ++i) {
+        ++placed[ultramarine::default_key_hasher{}(i * shards) % shards];
+    }
+
+    for (auto count : placed) {
+        BOOST_CHECK(count > 800 && count < 1200);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (key_hash_string_bytes) {
+    for (std::size_t len : {0, 3, 8, 16, 17, 63, 64, 65, 1030, 4096}) {
+        std::string key(len, 'k');
+        auto hash = ultramarine::default_key_hasher{}(key);
+
+        BOOST_CHECK(hash == ultramarine::default_key_hasher{}(std::string_view(key)));
+        if (len) {
+            key[len / 2] = 'j';
+            BOOST_CHECK(hash != ultramarine::default_key_hasher{}(key));
+        }
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (key_hash_identity) {
+    BOOST_CHECK(ultramarine::identity_key_hasher{}(42UL) == 42);
+    BOOST_CHECK(ultramarine::default_key_hasher{}(custom_key{42}) != 42);
+}
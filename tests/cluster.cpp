@@ -0,0 +1,94 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <type_traits>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/thread.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+#include <ultramarine/message_deduplicate.hpp>
+#include <ultramarine/cluster/impl/message_handler_registry.hpp>
+
+#ifndef ULTRAMARINE_REMOTE
+#error "test-cluster must be built against Ultramarine::cluster"
+#endif
+
+class packed_actor : public ultramarine::actor<packed_actor> {
+ULTRAMARINE_DEFINE_ACTOR(packed_actor, (add)(sum));
+
+public:
+    int total = 0;
+
+    void add(int value) { total += value; }
+
+    int sum(int value) const { return total + value; }
+};
+
+using remote_ref = ultramarine::cluster::impl::remote_actor_ref<packed_actor>;
+using packed_ints = ultramarine::packed_arguments<int>;
+
+// Instantiating the remote branch is enough: without a running cluster, references never resolve to a remote node
+SEASTAR_THREAD_TEST_CASE (remote_deduplicated_send_builds) {
+    using add_future = decltype(std::declval<remote_ref const &>().tell_packed(
+            packed_actor::message::add(), std::declval<packed_ints &&>()));
+    using sum_future = decltype(std::declval<remote_ref const &>().tell_packed(
+            packed_actor::message::sum(), std::declval<packed_ints &&>()));
+    static_assert(std::is_same_v<add_future, seastar::future<>>);
+    static_assert(std::is_same_v<sum_future, seastar::future<std::vector<int>>>);
+
+    auto send = [](ultramarine::actor_ref<packed_actor> ref) {
+        return ultramarine::deduplicate(ref, packed_actor::message::add(), [](auto &d) {
+            d(1);
+        });
+    };
+    auto stream = [](ultramarine::actor_ref<packed_actor> ref) {
+        return ultramarine::deduplicate_stream(ref, packed_actor::message::sum(), ultramarine::stream_options(),
+                                               [](auto &d) {
+                                                   return d(1);
+                                               });
+    };
+    BOOST_REQUIRE((std::is_invocable_v<decltype(send), ultramarine::actor_ref<packed_actor>>));
+    BOOST_REQUIRE((std::is_invocable_v<decltype(stream), ultramarine::actor_ref<packed_actor>>));
+}
+
+SEASTAR_THREAD_TEST_CASE (colliding_message_verbs_are_detected) {
+    using namespace ultramarine::cluster::impl;
+    auto conflicts = message_verb_conflicts().size();
+    auto message = packed_actor::message::add().value;
+
+    claim_message_verbs(message);
+    BOOST_REQUIRE(message_verb_conflicts().size() == conflicts);
+
+    // A message whose regular identity is the one-way identity of another one
+    auto colliding = ultramarine::impl::one_way_identity(message);
+    claim_message_verbs(colliding);
+    BOOST_REQUIRE(message_verb_conflicts().size() > conflicts);
+
+    message_verb_conflicts().resize(conflicts);
+    for (auto verb : {colliding, ultramarine::impl::one_way_identity(colliding), colliding | 1U}) {
+        if (message_verbs()[verb] == colliding) {
+            message_verbs().erase(verb);
+        }
+    }
+}
@@ -0,0 +1,202 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <vector>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/thread.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+
+static thread_local int deactivations = 0;
+
+class deactivatable_counter_actor : public ultramarine::actor<deactivatable_counter_actor>,
+                                    public ultramarine::deactivatable_actor<deactivatable_counter_actor> {
+ULTRAMARINE_DEFINE_ACTOR(deactivatable_counter_actor, (increase_counter)(get_counter)(slow_message));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    int counter = 0;
+
+    void increase_counter() {
+        counter++;
+    }
+
+    int get_counter() const {
+        return counter;
+    }
+
+    seastar::future<> slow_message() const {
+        return seastar::sleep(std::chrono::milliseconds(50));
+    }
+
+    seastar::future<> on_deactivate() {
+        ++deactivations;
+        return seastar::make_ready_future();
+    }
+};
+
+class idle_actor : public ultramarine::actor<idle_actor>, public ultramarine::deactivatable_actor<idle_actor, 1> {
+ULTRAMARINE_DEFINE_ACTOR(idle_actor, (noop));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    void noop() const {}
+};
+
+class staged_deactivatable_actor : public ultramarine::actor<staged_deactivatable_actor>,
+                                   public ultramarine::deactivatable_actor<staged_deactivatable_actor>,
+                                   public ultramarine::staged_actor<staged_deactivatable_actor> {
+ULTRAMARINE_DEFINE_ACTOR(staged_deactivatable_actor, (increase_counter)(get_counter));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    int counter = 0;
+
+    void increase_counter() {
+        counter++;
+    }
+
+    int get_counter() const {
+        return counter;
+    }
+};
+
+class sized_actor : public ultramarine::actor<sized_actor>,
+                    public ultramarine::deactivatable_actor<sized_actor> {
+ULTRAMARINE_DEFINE_ACTOR(sized_actor, (fill));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    std::vector<char> buffer;
+
+    void fill() {
+        buffer.resize(64 * 1024);
+    }
+
+    std::size_t memory_usage() const {
+        return buffer.capacity();
+    }
+};
+
+using namespace seastar;
+
+SEASTAR_THREAD_TEST_CASE (explicit_deactivation) {
+    auto ref = ultramarine::get<deactivatable_counter_actor>(0);
+    auto before = deactivations;
+
+    ref.tell(deactivatable_counter_actor::message::increase_counter()).wait();
+    BOOST_REQUIRE(ref.tell(deactivatable_counter_actor::message::get_counter()).get0() == 1);
+
+    ref.deactivate().wait();
+    BOOST_REQUIRE(deactivations == before + 1);
+    BOOST_REQUIRE(ref.tell(deactivatable_counter_actor::message::get_counter()).get0() == 0);
+}
+
+SEASTAR_THREAD_TEST_CASE (deactivation_waits_for_pending_messages) {
+    auto ref = ultramarine::get<deactivatable_counter_actor>(0);
+
+    auto slow = ref.tell(deactivatable_counter_actor::message::slow_message());
+    auto deactivation = ref.deactivate();
+    BOOST_REQUIRE(!deactivation.available());
+    slow.wait();
+    deactivation.wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (memory_budget_eviction) {
+    deactivatable_counter_actor::clear_directory().wait();
+    ultramarine::set_activation_memory_budget(sizeof(deactivatable_counter_actor) * 10);
+
+    for (int i = 0; i < 100; ++i) {
+        ultramarine::get<deactivatable_counter_actor>(i * seastar::smp::count)
+                .tell(deactivatable_counter_actor::message::increase_counter()).wait();
+        seastar::later().wait();
+    }
+
+    BOOST_REQUIRE(deactivatable_counter_actor::directory->size() <= 10);
+    ultramarine::set_activation_memory_budget(std::numeric_limits<std::size_t>::max());
+}
+
+SEASTAR_THREAD_TEST_CASE (idle_timeout_deactivation) {
+    ultramarine::get<idle_actor>(0).tell(idle_actor::message::noop()).wait();
+    BOOST_REQUIRE(idle_actor::directory->size() == 1);
+
+    seastar::sleep(std::chrono::milliseconds(2500)).wait();
+    BOOST_REQUIRE(idle_actor::directory->empty());
+}
+
+SEASTAR_THREAD_TEST_CASE (deactivation_waits_for_staged_messages) {
+    auto ref = ultramarine::get<staged_deactivatable_actor>(0);
+
+    // The stage runs the message in a later task, after the deactivation request
+    auto staged = ref.tell(staged_deactivatable_actor::message::increase_counter());
+    auto deactivation = ref.deactivate();
+    BOOST_REQUIRE(!staged.available());
+    BOOST_REQUIRE(!deactivation.available());
+    staged.wait();
+    deactivation.wait();
+    BOOST_REQUIRE(ref.tell(staged_deactivatable_actor::message::get_counter()).get0() == 0);
+}
+
+SEASTAR_THREAD_TEST_CASE (memory_budget_counts_reported_usage) {
+    sized_actor::clear_directory().wait();
+    ultramarine::set_activation_memory_budget(10 * 64 * 1024);
+
+    for (int i = 0; i < 100; ++i) {
+        ultramarine::get<sized_actor>(i * seastar::smp::count).tell(sized_actor::message::fill()).wait();
+        seastar::later().wait();
+    }
+
+    BOOST_REQUIRE(sized_actor::directory->size() <= 10);
+    ultramarine::set_activation_memory_budget(std::numeric_limits<std::size_t>::max());
+}
+
+SEASTAR_THREAD_TEST_CASE (reclaim_reports_returned_memory_only) {
+    deactivatable_counter_actor::clear_directory().wait();
+    idle_actor::clear_directory().wait();
+    staged_deactivatable_actor::clear_directory().wait();
+    sized_actor::clear_directory().wait();
+    using ultramarine::impl::deactivation_registry;
+    using seastar::memory::reclaiming_result;
+
+    for (int i = 0; i < 10; ++i) {
+        ultramarine::get<deactivatable_counter_actor>(i * seastar::smp::count)
+                .tell(deactivatable_counter_actor::message::increase_counter()).wait();
+    }
+    BOOST_REQUIRE(deactivation_registry::reclaim() == reclaiming_result::reclaimed_nothing);
+    BOOST_REQUIRE(deactivation_registry::reclaim() == reclaiming_result::reclaimed_nothing);
+    BOOST_REQUIRE(deactivatable_counter_actor::directory->size() < 10);
+
+    ultramarine::get<sized_actor>(0).tell(sized_actor::message::fill()).wait();
+    bool reclaimed = false;
+    for (int i = 0; i < 3 && !reclaimed; ++i) {
+        reclaimed = deactivation_registry::reclaim() == reclaiming_result::reclaimed_something;
+    }
+    BOOST_REQUIRE(reclaimed);
+    BOOST_REQUIRE(sized_actor::directory->size() == 0);
+}
@@ -28,6 +28,8 @@
 
 class error_actor : public ultramarine::actor<error_actor> {
 public:
+    using Hasher = ultramarine::identity_key_hasher;
+
     void void_throws() {
         throw std::runtime_error("error");
     }
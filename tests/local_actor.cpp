@@ -22,7 +22,9 @@
  * SOFTWARE.
  */
 
+#include <algorithm>
 #include <numeric>
+#include <vector>
 #include <seastar/testing/thread_test_case.hh>
 #include <seastar/core/thread.hh>
 #include <seastar/core/sleep.hh>
@@ -45,6 +47,84 @@ class actor2 : public ultramarine::actor<actor2>, public ultramarine::local_acto
 ULTRAMARINE_DEFINE_ACTOR(actor2, (stall));
 };
 
+class actor3 : public ultramarine::actor<actor3>,
+               public ultramarine::local_actor<actor3, std::numeric_limits<std::size_t>::max(),
+                       ultramarine::impl::least_loaded_shard_selection> {
+    seastar::future<seastar::shard_id> stall() {
+        return seastar::sleep(std::chrono::milliseconds(100)).then([] {
+            return seastar::engine().cpu_id();
+        });
+    }
+
+ULTRAMARINE_DEFINE_ACTOR(actor3, (stall));
+};
+
+class actor4 : public ultramarine::actor<actor4>, public ultramarine::local_actor<actor4>,
+               public ultramarine::work_stealing_actor<actor4, 4, 1> {
+    seastar::future<int> square(int i) {
+        ++handled;
+        return seastar::sleep(std::chrono::milliseconds(i % 4 ? 1 : 20)).then([i] {
+            return i * i;
+        });
+    }
+
+public:
+    static inline thread_local int handled = 0;
+
+ULTRAMARINE_DEFINE_ACTOR(actor4, (square));
+};
+
+class actor5 : public ultramarine::actor<actor5>, public ultramarine::local_actor<actor5, 1>,
+               public ultramarine::non_reentrant_actor<actor5>, public ultramarine::pooled_actor<actor5, 1, 4, 100> {
+    seastar::future<> stall() {
+        max_running = std::max(max_running, ++running);
+        return seastar::sleep(std::chrono::milliseconds(100)).then([] {
+            --running;
+        });
+    }
+
+public:
+    static inline thread_local int running = 0;
+    static inline thread_local int max_running = 0;
+
+ULTRAMARINE_DEFINE_ACTOR(actor5, (stall));
+};
+
+class actor6 : public ultramarine::actor<actor6>, public ultramarine::local_actor<actor6, 1>,
+               public ultramarine::non_reentrant_actor<actor6>, public ultramarine::pooled_actor<actor6, 1, 4, 100>,
+               public ultramarine::deactivatable_actor<actor6> {
+    seastar::future<> stall() {
+        return seastar::sleep(std::chrono::milliseconds(100));
+    }
+
+public:
+    static inline thread_local int deactivations = 0;
+
+    void on_deactivate() {
+        ++deactivations;
+    }
+
+ULTRAMARINE_DEFINE_ACTOR(actor6, (stall));
+};
+
+// Polls pred on shard 0 until it holds, for at most a few seconds
+template<typename Pred>
+bool wait_until(Pred pred) {
+    for (int i = 0; i < 100; ++i) {
+        if (seastar::smp::submit_to(0, pred).get0()) {
+            return true;
+        }
+        seastar::sleep(std::chrono::milliseconds(50)).wait();
+    }
+    return false;
+}
+
+// Polls the size of a directory on shard 0 until it reaches size
+template<typename Actor>
+bool wait_for_directory_size(std::size_t size) {
+    return wait_until([size] { return Actor::directory->size() == size; });
+}
+
 using namespace seastar;
 
 /*
@@ -79,4 +159,77 @@ SEASTAR_THREAD_TEST_CASE (local_actor_scheduling) {
     auto time2 = std::chrono::duration_cast<std::chrono::milliseconds>(end2 - start2);
 
     BOOST_CHECK(float(time1.count()) / time2.count() > 1.5f);
-}
\ No newline at end of file
+}
+SEASTAR_THREAD_TEST_CASE (least_loaded_local_actor_scheduling) {
+    auto ref = ultramarine::get<actor3>(0);
+
+    std::vector<seastar::future<seastar::shard_id>> stalls;
+    for (std::size_t i = 0; i < 2 * seastar::smp::count; ++i) {
+        stalls.emplace_back(ref.tell(actor3::message::stall()));
+    }
+
+    std::vector<std::size_t> per_shard(seastar::smp::count);
+    for (auto &stall : stalls) {
+        ++per_shard[stall.get0()];
+    }
+    BOOST_REQUIRE(seastar::smp::count == 1 || per_shard[0] < stalls.size());
+    for (seastar::shard_id shard = 0; shard < seastar::smp::count; ++shard) {
+        BOOST_REQUIRE(ultramarine::impl::shard_load<actor3>::depth(shard) == 0);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (work_stealing_local_actor) {
+    auto ref = ultramarine::get<actor4>(0);
+
+    std::vector<seastar::future<int>> squares;
+    for (int i = 0; i < 200; ++i) {
+        squares.emplace_back(ref.tell(actor4::message::square(), i));
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        BOOST_REQUIRE(squares[i].get0() == i * i);
+    }
+    using load = ultramarine::impl::shard_load<ultramarine::impl::work_stealing_queue<actor4>>;
+    int stolen = 0;
+    for (seastar::shard_id shard = 0; shard < seastar::smp::count; ++shard) {
+        BOOST_REQUIRE(load::depth(shard) == 0);
+        if (shard) {
+            stolen += seastar::smp::submit_to(shard, [] { return actor4::handled; }).get0();
+        }
+    }
+    if (seastar::smp::count > 1) {
+        BOOST_REQUIRE(stolen > 0);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (pooled_local_actor_scheduling) {
+    auto ref = ultramarine::get<actor5>(0);
+
+    seastar::when_all(
+            ref.tell(actor5::message::stall()),
+            ref.tell(actor5::message::stall()),
+            ref.tell(actor5::message::stall()),
+            ref.tell(actor5::message::stall())
+    ).wait();
+
+    BOOST_REQUIRE(seastar::smp::submit_to(0, [] { return actor5::max_running; }).get0() == 4);
+    BOOST_REQUIRE(wait_for_directory_size<actor5>(1));
+    BOOST_REQUIRE(wait_until([] { return ultramarine::impl::pool_service<actor5>::pools.empty(); }));
+
+    ref.tell(actor5::message::stall()).wait();
+    BOOST_REQUIRE(seastar::smp::submit_to(0, [] { return actor5::directory->size(); }).get0() == 1);
+}
+
+SEASTAR_THREAD_TEST_CASE (pooled_deactivatable_actor_shrink) {
+    auto ref = ultramarine::get<actor6>(0);
+
+    seastar::when_all(
+            ref.tell(actor6::message::stall()),
+            ref.tell(actor6::message::stall()),
+            ref.tell(actor6::message::stall()),
+            ref.tell(actor6::message::stall())
+    ).wait();
+
+    BOOST_REQUIRE(wait_for_directory_size<actor6>(1));
+    BOOST_REQUIRE(seastar::smp::submit_to(0, [] { return actor6::deactivations; }).get0() == 3);
+}
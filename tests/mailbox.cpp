@@ -0,0 +1,223 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+#include <numeric>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/thread.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+
+class ordered_actor : public ultramarine::actor<ordered_actor>, public ultramarine::non_reentrant_actor<ordered_actor> {
+ULTRAMARINE_DEFINE_ACTOR(ordered_actor, (append)(get_values));
+
+public:
+    std::vector<int> values;
+    bool running = false;
+
+    seastar::future<> append(int value) {
+        BOOST_REQUIRE(!running);
+        running = true;
+        return seastar::sleep(std::chrono::milliseconds(1)).then([this, value] {
+            values.push_back(value);
+            running = false;
+        });
+    }
+
+    std::vector<int> get_values() const {
+        return values;
+    }
+};
+
+class fail_fast_actor : public ultramarine::actor<fail_fast_actor>,
+                        public ultramarine::non_reentrant_actor<fail_fast_actor, 1,
+                                ultramarine::mailbox_policy::fail_fast> {
+ULTRAMARINE_DEFINE_ACTOR(fail_fast_actor, (stall));
+
+public:
+    seastar::future<> stall() const {
+        return seastar::sleep(std::chrono::milliseconds(50));
+    }
+};
+
+class drop_oldest_actor : public ultramarine::actor<drop_oldest_actor>,
+                          public ultramarine::non_reentrant_actor<drop_oldest_actor, 1,
+                                  ultramarine::mailbox_policy::drop_oldest> {
+ULTRAMARINE_DEFINE_ACTOR(drop_oldest_actor, (stall));
+
+public:
+    seastar::future<> stall() const {
+        return seastar::sleep(std::chrono::milliseconds(50));
+    }
+};
+
+class timeout_actor : public ultramarine::actor<timeout_actor>,
+                      public ultramarine::non_reentrant_actor<timeout_actor,
+                              std::numeric_limits<std::size_t>::max(), ultramarine::mailbox_policy::block, 100> {
+ULTRAMARINE_DEFINE_ACTOR(timeout_actor, (stall));
+
+public:
+    seastar::future<> stall() const {
+        return seastar::sleep(std::chrono::milliseconds(500));
+    }
+};
+
+class catalog_actor : public ultramarine::actor<catalog_actor>,
+                      public ultramarine::reader_writer_actor<catalog_actor> {
+ULTRAMARINE_DEFINE_ACTOR(catalog_actor, (read)(write)(get_max_readers));
+
+public:
+    int value = 0;
+    bool writing = false;
+    mutable int readers = 0;
+    mutable int max_readers = 0;
+
+    seastar::future<int> read() const {
+        BOOST_REQUIRE(!writing);
+        max_readers = std::max(max_readers, ++readers);
+        return seastar::sleep(std::chrono::milliseconds(5)).then([this] {
+            --readers;
+            return value;
+        });
+    }
+
+    seastar::future<> write(int v) {
+        BOOST_REQUIRE(!writing && !readers);
+        writing = true;
+        return seastar::sleep(std::chrono::milliseconds(5)).then([this, v] {
+            value = v;
+            writing = false;
+        });
+    }
+
+    int get_max_readers() const {
+        return max_readers;
+    }
+};
+
+using namespace seastar;
+
+SEASTAR_THREAD_TEST_CASE (mailbox_preserves_order) {
+    auto ref = ultramarine::get<ordered_actor>(0);
+
+    std::vector<seastar::future<>> futs;
+    for (int i = 0; i < 100; ++i) {
+        futs.emplace_back(ref.tell(ordered_actor::message::append(), i));
+    }
+    seastar::when_all(std::begin(futs), std::end(futs)).wait();
+
+    std::vector<int> expected(100);
+    std::iota(std::begin(expected), std::end(expected), 0);
+    BOOST_REQUIRE(ref.tell(ordered_actor::message::get_values()).get0() == expected);
+}
+
+SEASTAR_THREAD_TEST_CASE (mailbox_fail_fast) {
+    auto ref = ultramarine::get<fail_fast_actor>(0);
+
+    auto running = ref.tell(fail_fast_actor::message::stall());
+    auto queued = ref.tell(fail_fast_actor::message::stall());
+    auto rejected = ref.tell(fail_fast_actor::message::stall());
+
+    BOOST_REQUIRE_THROW(rejected.get(), ultramarine::mailbox_full);
+    running.wait();
+    queued.wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (mailbox_drop_oldest) {
+    auto ref = ultramarine::get<drop_oldest_actor>(0);
+
+    auto running = ref.tell(drop_oldest_actor::message::stall());
+    auto dropped = ref.tell(drop_oldest_actor::message::stall());
+    auto queued = ref.tell(drop_oldest_actor::message::stall());
+
+    BOOST_REQUIRE_THROW(dropped.get(), ultramarine::message_dropped);
+    running.wait();
+    queued.wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (mailbox_timeout) {
+    auto ref = ultramarine::get<timeout_actor>(0);
+
+    auto running = ref.tell(timeout_actor::message::stall());
+    auto queued = ref.tell(timeout_actor::message::stall());
+
+    BOOST_REQUIRE_THROW(queued.get(), ultramarine::mailbox_timed_out);
+    running.wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (mailbox_concurrent_readers) {
+    auto ref = ultramarine::get<catalog_actor>(0);
+
+    std::vector<seastar::future<int>> futs;
+    for (int i = 0; i < 10; ++i) {
+        futs.emplace_back(ref.tell(catalog_actor::message::read()));
+    }
+    seastar::when_all(std::begin(futs), std::end(futs)).wait();
+
+    BOOST_REQUIRE(ref.tell(catalog_actor::message::get_max_readers()).get0() == 10);
+}
+
+SEASTAR_THREAD_TEST_CASE (mailbox_exclusive_writer) {
+    auto ref = ultramarine::get<catalog_actor>(1);
+
+    auto before = ref.tell(catalog_actor::message::read());
+    auto also_before = ref.tell(catalog_actor::message::read());
+    auto write = ref.tell(catalog_actor::message::write(), 42);
+    auto after = ref.tell(catalog_actor::message::read());
+
+    BOOST_REQUIRE(before.get0() == 0);
+    BOOST_REQUIRE(also_before.get0() == 0);
+    write.wait();
+    BOOST_REQUIRE(after.get0() == 42);
+}
+
+SEASTAR_THREAD_TEST_CASE (mailbox_block_waits_for_space) {
+    ultramarine::impl::mailbox<1, ultramarine::mailbox_policy::block, 0> mailbox;
+
+    mailbox.enter();
+    auto queued = mailbox.post([] { return 1; });
+    auto blocked = mailbox.post([] { return 2; });
+    seastar::later().wait();
+
+    BOOST_REQUIRE(mailbox.pending() == 1);
+    BOOST_REQUIRE(!blocked.available());
+
+    mailbox.leave(seastar::make_ready_future<>()).wait();
+    BOOST_REQUIRE(queued.get0() == 1);
+    BOOST_REQUIRE(blocked.get0() == 2);
+    BOOST_REQUIRE(mailbox.pending() == 0);
+}
+
+SEASTAR_THREAD_TEST_CASE (mailbox_block_times_out) {
+    ultramarine::impl::mailbox<1, ultramarine::mailbox_policy::block, 50> mailbox;
+
+    mailbox.enter();
+    auto queued = mailbox.post([] { return 1; });
+    auto blocked = mailbox.post([] { return 2; });
+
+    BOOST_REQUIRE_THROW(blocked.get(), ultramarine::mailbox_timed_out);
+    BOOST_REQUIRE_THROW(queued.get(), ultramarine::mailbox_timed_out);
+    mailbox.leave(seastar::make_ready_future<>()).wait();
+}
@@ -23,8 +23,10 @@
  */
 
 #include <numeric>
+#include <boost/range/irange.hpp>
 #include <seastar/testing/thread_test_case.hh>
 #include <seastar/core/thread.hh>
+#include <seastar/core/sleep.hh>
 #include <ultramarine/actor.hpp>
 #include <ultramarine/actor_ref.hpp>
 #include <ultramarine/message_deduplicate.hpp>
@@ -177,6 +179,55 @@ public:
 
 };
 
+class echo_actor : public ultramarine::actor<echo_actor> {
+ULTRAMARINE_DEFINE_ACTOR(echo_actor, (delayed_echo));
+
+public:
+    seastar::future<int> delayed_echo(int value) const {
+        return seastar::sleep(std::chrono::microseconds((value % 7) * 100)).then([value] {
+            return value;
+        });
+    }
+};
+
+class batch_actor : public ultramarine::actor<batch_actor> {
+ULTRAMARINE_DEFINE_ACTOR(batch_actor, (increment)(square)(append)(get_count)(get_batch_calls));
+
+public:
+    std::size_t count = 0;
+    std::size_t batch_calls = 0;
+
+    void increment() { ++count; }
+
+    void increment_batch(ultramarine::packed_arguments<> const &calls) {
+        count += std::size(calls);
+        ++batch_calls;
+    }
+
+    int square(int value) const { return value * value; }
+
+    seastar::future<std::vector<int>> square_batch(ultramarine::packed_arguments<int> &&values) {
+        std::vector<int> ret;
+        ret.reserve(std::size(values));
+        for (auto &[value] : values) {
+            ret.push_back(value * value);
+        }
+        ++batch_calls;
+        return seastar::make_ready_future<std::vector<int>>(std::move(ret));
+    }
+
+    void append(std::string) { ++count; }
+
+    void append_batch(ultramarine::packed_arguments<std::string> &&calls) {
+        count += std::size(calls);
+        ++batch_calls;
+    }
+
+    std::size_t get_count() const { return count; }
+
+    std::size_t get_batch_calls() const { return batch_calls; }
+};
+
 using namespace seastar;
 
 /*
@@ -644,4 +695,116 @@ SEASTAR_THREAD_TEST_CASE (ensure_worker_void_exception_void_message_packing) {
     }).handle_exception_type([](std::runtime_error const &ex) {
         BOOST_CHECK(std::strcmp(ex.what(), "error") == 0);
     }).wait();
-}
\ No newline at end of file
+}
+
+SEASTAR_THREAD_TEST_CASE (ensure_packed_results_order) {
+    auto echoActor = ultramarine::get<echo_actor>(0);
+    auto results = ultramarine::deduplicate(echoActor, echo_actor::message::delayed_echo(), [](auto &d) {
+        for (int j = 0; j < 1000; ++j) {
+            d(j);
+        }
+    }).get0();
+
+    std::vector<int> expected(1000);
+    std::iota(std::begin(expected), std::end(expected), 0);
+    BOOST_REQUIRE(results == expected);
+}
+
+SEASTAR_THREAD_TEST_CASE (ensure_streamed_results_order) {
+    auto echoActor = ultramarine::get<echo_actor>(1);
+    ultramarine::stream_options options;
+    options.chunk_size = 64;
+    options.max_in_flight = 2;
+
+    auto results = ultramarine::deduplicate_stream(echoActor, echo_actor::message::delayed_echo(), options,
+                                                   [](auto &d) {
+        return seastar::do_for_each(boost::irange(0, 1000), [&d](int j) {
+            return d(j);
+        });
+    }).get0();
+
+    std::vector<int> expected(1000);
+    std::iota(std::begin(expected), std::end(expected), 0);
+    BOOST_REQUIRE(results == expected);
+}
+
+SEASTAR_THREAD_TEST_CASE (ensure_streamed_byte_threshold) {
+    auto counterActor = ultramarine::get<counter_actor>(1);
+    auto count = counterActor->get_count().get0();
+    ultramarine::stream_options options;
+    options.chunk_bytes = 1;
+
+    ultramarine::deduplicate_stream(counterActor, counter_actor::message::increment(), options, [](auto &d) {
+        return seastar::do_for_each(boost::irange(0, 100), [&d](int) {
+            return d();
+        });
+    }).wait();
+
+    BOOST_REQUIRE(counterActor->get_count().get0() == count + 100);
+}
+
+SEASTAR_THREAD_TEST_CASE (ensure_streamed_payload_bytes) {
+    auto batchActor = ultramarine::get<batch_actor>(1);
+    auto count = batchActor->get_count().get0();
+    auto calls = batchActor->get_batch_calls().get0();
+    ultramarine::stream_options options;
+    options.chunk_bytes = 10 * 1024;
+    options.max_in_flight = 1;
+
+    ultramarine::deduplicate_stream(batchActor, batch_actor::message::append(), options, [](auto &d) {
+        return seastar::do_for_each(boost::irange(0, 100), [&d](int) {
+            return d(std::string(1000, 'x'));
+        });
+    }).wait();
+
+    BOOST_REQUIRE(batchActor->get_count().get0() == count + 100);
+    BOOST_REQUIRE(batchActor->get_batch_calls().get0() >= calls + 5);
+}
+
+SEASTAR_THREAD_TEST_CASE (ensure_streamed_exception) {
+    auto counterActor = ultramarine::get<counter_actor>(0);
+    ultramarine::stream_options options;
+    options.chunk_size = 3;
+
+    ultramarine::deduplicate_stream(counterActor, counter_actor::message::void_exception_void(), options,
+                                    [](auto &d) {
+        return seastar::do_for_each(boost::irange(0, 10), [&d](int) {
+            return d();
+        });
+    }).then([] {
+        BOOST_FAIL("received response, expected exception");
+    }).handle_exception_type([](std::runtime_error const &ex) {
+        BOOST_CHECK(std::strcmp(ex.what(), "error") == 0);
+    }).wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (ensure_batch_handler_void) {
+    auto batchActor = ultramarine::get<batch_actor>(0);
+    auto calls = batchActor->get_batch_calls().get0();
+
+    ultramarine::deduplicate(batchActor, batch_actor::message::increment(), [](auto &d) {
+        for (int j = 0; j < 10000; ++j) {
+            d();
+        }
+    }).wait();
+
+    BOOST_REQUIRE(batchActor->get_count().get0() == 10000);
+    BOOST_REQUIRE(batchActor->get_batch_calls().get0() == calls + 1);
+}
+
+SEASTAR_THREAD_TEST_CASE (ensure_batch_handler_values) {
+    auto batchActor = ultramarine::get<batch_actor>(1);
+    auto calls = batchActor->get_batch_calls().get0();
+
+    auto results = ultramarine::deduplicate(batchActor, batch_actor::message::square(), [](auto &d) {
+        for (int j = 0; j < 100; ++j) {
+            d(j);
+        }
+    }).get0();
+
+    BOOST_REQUIRE(results.size() == 100);
+    for (int j = 0; j < 100; ++j) {
+        BOOST_REQUIRE(results[j] == j * j);
+    }
+    BOOST_REQUIRE(batchActor->get_batch_calls().get0() == calls + 1);
+}
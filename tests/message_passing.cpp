@@ -22,9 +22,13 @@
  * SOFTWARE.
  */
 
+#include <atomic>
 #include <numeric>
+#include <optional>
 #include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/sleep.hh>
 #include <seastar/core/thread.hh>
+#include <seastar/core/with_timeout.hh>
 #include <ultramarine/actor.hpp>
 #include <ultramarine/actor_ref.hpp>
 
@@ -57,9 +61,11 @@ ULTRAMARINE_DEFINE_ACTOR(counter_actor,
                          (get_execution_shard)
                                  (increase_counter_future)(increase_counter_void)(get_counter_future)(get_counter_int)
                                  (move_arg_message)(move_return_value_message)(move_return_future_message)
-                                 (actor_ref_copy)(poly_actor_ref_copy));
+                                 (actor_ref_copy)(poly_actor_ref_copy)(payload_address)(unique_payload));
 
 public:
+    using Hasher = ultramarine::identity_key_hasher;
+
     int counter = 0;
 
     seastar::future<> increase_counter_future() {
@@ -101,6 +107,223 @@ public:
     seastar::future<> poly_actor_ref_copy(ultramarine::poly_actor_ref other) const {
         return other.as<counter_actor>().tell(counter_actor::message::get_counter_future()).discard_result();
     }
+
+    std::uintptr_t payload_address(std::vector<char> const &payload) const {
+        return reinterpret_cast<std::uintptr_t>(payload.data());
+    }
+
+    int unique_payload(std::unique_ptr<int> const &payload) const {
+        return *payload;
+    }
+};
+
+class direct_counter_actor : public ultramarine::actor<direct_counter_actor>,
+                             public ultramarine::direct_dispatch_actor<direct_counter_actor> {
+ULTRAMARINE_DEFINE_ACTOR(direct_counter_actor, (increase_counter_void)(get_counter_int)(move_arg_message));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    int counter = 0;
+
+    void increase_counter_void() {
+        counter++;
+    }
+
+    int get_counter_int() const {
+        return counter;
+    }
+
+    void move_arg_message(no_copy_message arg) const {
+    }
+};
+
+class direct_chain_actor : public ultramarine::actor<direct_chain_actor>,
+                           public ultramarine::direct_dispatch_actor<direct_chain_actor> {
+ULTRAMARINE_DEFINE_ACTOR(direct_chain_actor, (relay));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    // Every hop stays on the shard of the first actor
+    seastar::future<int> relay(int hops) const {
+        if (!hops) {
+            return seastar::make_ready_future<int>(0);
+        }
+        return ultramarine::get<direct_chain_actor>(key + seastar::smp::count)->relay(hops - 1).then([](int depth) {
+            return depth + 1;
+        });
+    }
+};
+
+class coalesced_counter_actor : public ultramarine::actor<coalesced_counter_actor>,
+                                public ultramarine::coalesced_actor<coalesced_counter_actor, 8> {
+ULTRAMARINE_DEFINE_ACTOR(coalesced_counter_actor,
+                         (get_execution_shard)(append_value)(get_values)(move_arg_message)(throw_message)(wait_gate)(
+                                 open_gate));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    std::vector<int> values;
+    std::optional<seastar::promise<>> gate;
+
+    seastar::future<seastar::shard_id> get_execution_shard() const {
+        return seastar::make_ready_future<seastar::shard_id>(seastar::engine().cpu_id());
+    }
+
+    void append_value(int value) {
+        values.push_back(value);
+    }
+
+    std::vector<int> get_values() const {
+        return values;
+    }
+
+    void move_arg_message(no_copy_message arg) const {
+    }
+
+    seastar::future<> throw_message() const {
+        return seastar::make_exception_future(std::runtime_error("coalesced"));
+    }
+
+    seastar::future<> wait_gate() {
+        gate.emplace();
+        return gate->get_future();
+    }
+
+    void open_gate() {
+        if (gate) {
+            gate->set_value();
+            gate.reset();
+        }
+    }
+};
+
+class staged_counter_actor : public ultramarine::actor<staged_counter_actor>,
+                             public ultramarine::staged_actor<staged_counter_actor> {
+ULTRAMARINE_DEFINE_ACTOR(staged_counter_actor, (append_value)(get_values)(move_arg_message)(throw_message));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    std::vector<int> values;
+
+    void append_value(int value) {
+        values.push_back(value);
+    }
+
+    std::vector<int> get_values() const {
+        return values;
+    }
+
+    void move_arg_message(no_copy_message arg) const {
+    }
+
+    seastar::future<> throw_message() const {
+        return seastar::make_exception_future(std::runtime_error("staged"));
+    }
+};
+
+class lookup_actor : public ultramarine::actor<lookup_actor>,
+                     public ultramarine::single_flight_actor<lookup_actor> {
+ULTRAMARINE_DEFINE_ACTOR(lookup_actor, (lookup)(touch)(get_executions));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    mutable int executions = 0;
+
+    seastar::future<int> lookup(int value) const {
+        ++executions;
+        return seastar::sleep(std::chrono::milliseconds(10)).then([value] {
+            return value * 2;
+        });
+    }
+
+    seastar::future<> touch(int) {
+        ++executions;
+        return seastar::sleep(std::chrono::milliseconds(10));
+    }
+
+    int get_executions() const {
+        return executions;
+    }
+};
+
+class resolving_actor : public ultramarine::actor<resolving_actor>,
+                        public ultramarine::staged_actor<resolving_actor>,
+                        public ultramarine::single_flight_actor<resolving_actor> {
+ULTRAMARINE_DEFINE_ACTOR(resolving_actor, (resolve)(get_executions));
+
+public:
+    mutable int executions = 0;
+
+    seastar::future<int> resolve(int value) const {
+        ++executions;
+        return ultramarine::get<lookup_actor>(100).forward(lookup_actor::message::lookup(), value);
+    }
+
+    int get_executions() const {
+        return executions;
+    }
+};
+
+class posting_actor : public ultramarine::actor<posting_actor> {
+ULTRAMARINE_DEFINE_ACTOR(posting_actor, (increment)(fail)(get_count));
+
+public:
+    static inline std::atomic<int> errors = 0;
+    int count = 0;
+
+    static void on_post_error(std::exception_ptr) {
+        ++errors;
+    }
+
+    void increment() {
+        ++count;
+    }
+
+    seastar::future<> fail() const {
+        return seastar::make_exception_future(std::runtime_error("posted"));
+    }
+
+    int get_count() const {
+        return count;
+    }
+};
+
+class forwarding_actor : public ultramarine::actor<forwarding_actor> {
+ULTRAMARINE_DEFINE_ACTOR(forwarding_actor, (relay)(relay_throw)(misforward)(resolve));
+
+public:
+    seastar::future<ultramarine::actor_id> relay(int remaining) const {
+        if (remaining > 0) {
+            return ultramarine::get<forwarding_actor>(key + 1).forward(message::relay(), remaining - 1);
+        }
+        return seastar::make_ready_future<ultramarine::actor_id>(key);
+    }
+
+    seastar::future<> relay_throw(int remaining) const {
+        if (remaining > 0) {
+            return ultramarine::get<forwarding_actor>(key + 1).forward(message::relay_throw(), remaining - 1);
+        }
+        return seastar::make_exception_future(std::runtime_error("forwarded"));
+    }
+
+    seastar::future<ultramarine::actor_id> misforward(int remaining) const {
+        auto next = ultramarine::get<forwarding_actor>(key + 1);
+        if (remaining > 1) {
+            return next.forward(message::misforward(), remaining - 1);
+        } else if (remaining == 1) {
+            next.forward(message::misforward(), remaining - 1).ignore_ready_future();
+        }
+        return seastar::make_ready_future<ultramarine::actor_id>(key);
+    }
+
+    seastar::future<int> resolve(int value) const {
+        return ultramarine::get<resolving_actor>(0).forward(resolving_actor::message::resolve(), value);
+    }
 };
 
 using namespace seastar;
@@ -170,6 +393,27 @@ SEASTAR_THREAD_TEST_CASE (same_core_move_poly_actor_ref) {
     counterActor.tell(counter_actor::message::poly_actor_ref_copy(), std::move(counterActor)).wait();
 }
 
+SEASTAR_THREAD_TEST_CASE (same_core_direct_dispatch_message_passing) {
+    auto counterActor = ultramarine::get<direct_counter_actor>(0);
+
+    auto ival = counterActor.tell(direct_counter_actor::message::get_counter_int()).get0();
+    auto fut = counterActor.tell(direct_counter_actor::message::increase_counter_void());
+    BOOST_REQUIRE(fut.available());
+    fut.wait();
+    auto nval = counterActor.tell(direct_counter_actor::message::get_counter_int()).get0();
+
+    BOOST_REQUIRE(nval == ival + 1);
+}
+
+SEASTAR_THREAD_TEST_CASE (same_core_direct_dispatch_nocopy_arg_message_passing) {
+    ultramarine::get<direct_counter_actor>(0).tell(direct_counter_actor::message::move_arg_message(),
+                                                   no_copy_message()).wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (same_core_direct_dispatch_long_chain) {
+    BOOST_REQUIRE(ultramarine::get<direct_chain_actor>(0)->relay(100000).get0() == 100000);
+}
+
 /*
  * Collocated
  */
@@ -233,4 +477,215 @@ SEASTAR_THREAD_TEST_CASE (collocated_core_move_poly_actor_ref) {
     auto counterActor = ultramarine::get<counter_actor>(1);
 
     counterActor.tell(counter_actor::message::poly_actor_ref_copy(), std::move(counterActor)).wait();
-}
\ No newline at end of file
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_core_handoff_payload) {
+    auto counterActor = ultramarine::get<counter_actor>(1);
+    std::vector<char> payload(64 * 1024);
+    auto address = reinterpret_cast<std::uintptr_t>(payload.data());
+
+    BOOST_REQUIRE(counterActor.tell(counter_actor::message::payload_address(), std::move(payload)).get0() == address);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_core_small_payload_moved_inline) {
+    ultramarine::impl::handoff<std::vector<char>> small(std::vector<char>(16));
+    ultramarine::impl::handoff<std::vector<char>> large(std::vector<char>(64 * 1024));
+
+    BOOST_REQUIRE(!small.ptr && small.get().size() == 16);
+    BOOST_REQUIRE(large.ptr && large.get().size() == 64 * 1024);
+
+    auto counterActor = ultramarine::get<counter_actor>(1);
+    std::vector<char> payload(16);
+    auto address = reinterpret_cast<std::uintptr_t>(payload.data());
+
+    BOOST_REQUIRE(counterActor.tell(counter_actor::message::payload_address(), std::move(payload)).get0() == address);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_core_copy_payload) {
+    auto counterActor = ultramarine::get<counter_actor>(1);
+    std::vector<char> payload(64 * 1024);
+    auto address = reinterpret_cast<std::uintptr_t>(payload.data());
+
+    BOOST_REQUIRE(counterActor.tell(counter_actor::message::payload_address(), payload).get0() != address);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_core_handoff_move_only_payload) {
+    auto counterActor = ultramarine::get<counter_actor>(1);
+
+    BOOST_REQUIRE(counterActor->unique_payload(std::make_unique<int>(42)).get0() == 42);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_posted_messages) {
+    auto postingActor = ultramarine::get<posting_actor>(1);
+
+    for (int i = 0; i < 1000; ++i) {
+        postingActor->post_increment();
+    }
+    while (postingActor->get_count().get0() < 1000) {
+        seastar::later().get();
+    }
+    BOOST_REQUIRE(postingActor->get_count().get0() == 1000);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_posted_message_error) {
+    auto postingActor = ultramarine::get<posting_actor>(1);
+    auto errors = posting_actor::errors.load();
+
+    postingActor.post(posting_actor::message::fail());
+    while (posting_actor::errors.load() == errors) {
+        seastar::later().get();
+    }
+    BOOST_REQUIRE(posting_actor::errors.load() == errors + 1);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_forwarded_reply) {
+    BOOST_REQUIRE(ultramarine::get<forwarding_actor>(0)->relay(1000).get0() == 1000);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_forwarded_exception) {
+    BOOST_REQUIRE_THROW(ultramarine::get<forwarding_actor>(0)->relay_throw(100).get(), std::runtime_error);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_forwarded_reply_returned_twice) {
+    BOOST_REQUIRE_THROW(ultramarine::get<forwarding_actor>(0)->misforward(2).get(),
+                        ultramarine::reply_already_forwarded);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_forwarded_single_flight_replies_each) {
+    auto resolver = ultramarine::get<resolving_actor>(0);
+    auto before = resolver->get_executions().get0();
+    auto deadline = seastar::lowres_clock::now() + std::chrono::seconds(5);
+
+    auto first = seastar::with_timeout(deadline, ultramarine::get<forwarding_actor>(0)->resolve(21));
+    auto second = seastar::with_timeout(deadline, ultramarine::get<forwarding_actor>(1)->resolve(21));
+
+    BOOST_REQUIRE(first.get0() == 42);
+    BOOST_REQUIRE(second.get0() == 42);
+    BOOST_REQUIRE(resolver->get_executions().get0() == before + 2);
+}
+
+/*
+ * Collocated (coalesced)
+ */
+
+SEASTAR_THREAD_TEST_CASE (collocated_coalesced_core_location) {
+    auto counterActor = ultramarine::get<coalesced_counter_actor>(1);
+
+    auto shard = counterActor.tell(coalesced_counter_actor::message::get_execution_shard()).get0();
+    BOOST_CHECK(shard == 1 % seastar::smp::count);
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_coalesced_ordered_message_passing) {
+    auto counterActor = ultramarine::get<coalesced_counter_actor>(1);
+
+    std::vector<seastar::future<>> futs;
+    for (int i = 0; i < 20; ++i) {
+        futs.emplace_back(counterActor.tell(coalesced_counter_actor::message::append_value(), i));
+    }
+    seastar::when_all(std::begin(futs), std::end(futs)).wait();
+
+    std::vector<int> expected(20);
+    std::iota(std::begin(expected), std::end(expected), 0);
+    auto values = counterActor.tell(coalesced_counter_actor::message::get_values()).get0();
+    BOOST_REQUIRE(std::equal(std::end(values) - 20, std::end(values), std::begin(expected)));
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_coalesced_nocopy_arg_message_passing) {
+    ultramarine::get<coalesced_counter_actor>(1).tell(coalesced_counter_actor::message::move_arg_message(),
+                                                      no_copy_message()).wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_coalesced_reply_not_held_by_batch) {
+    auto counterActor = ultramarine::get<coalesced_counter_actor>(1);
+    auto deadline = seastar::lowres_clock::now() + std::chrono::seconds(5);
+
+    auto gated = counterActor.tell(coalesced_counter_actor::message::wait_gate());
+    auto shard = seastar::with_timeout(deadline, counterActor.tell(
+            coalesced_counter_actor::message::get_execution_shard())).get0();
+
+    BOOST_REQUIRE(shard == 1 % seastar::smp::count);
+    BOOST_REQUIRE(!gated.available());
+    counterActor.tell(coalesced_counter_actor::message::open_gate()).wait();
+    seastar::with_timeout(deadline, std::move(gated)).wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (collocated_coalesced_exception_message_passing) {
+    auto counterActor = ultramarine::get<coalesced_counter_actor>(1);
+
+    auto fut = counterActor.tell(coalesced_counter_actor::message::throw_message());
+    auto other = counterActor.tell(coalesced_counter_actor::message::get_execution_shard());
+    BOOST_REQUIRE_THROW(fut.get(), std::runtime_error);
+    other.wait();
+}
+
+/*
+ * Staged
+ */
+
+SEASTAR_THREAD_TEST_CASE (staged_ordered_message_passing) {
+    for (int key = 0; key < 2; ++key) {
+        auto counterActor = ultramarine::get<staged_counter_actor>(key);
+
+        std::vector<seastar::future<>> futs;
+        for (int i = 0; i < 20; ++i) {
+            futs.emplace_back(counterActor.tell(staged_counter_actor::message::append_value(), i));
+        }
+        seastar::when_all(std::begin(futs), std::end(futs)).wait();
+
+        std::vector<int> expected(20);
+        std::iota(std::begin(expected), std::end(expected), 0);
+        auto values = counterActor.tell(staged_counter_actor::message::get_values()).get0();
+        BOOST_REQUIRE(std::equal(std::end(values) - 20, std::end(values), std::begin(expected)));
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (staged_nocopy_arg_message_passing) {
+    ultramarine::get<staged_counter_actor>(0).tell(staged_counter_actor::message::move_arg_message(),
+                                                   no_copy_message()).wait();
+    ultramarine::get<staged_counter_actor>(1).tell(staged_counter_actor::message::move_arg_message(),
+                                                   no_copy_message()).wait();
+}
+
+SEASTAR_THREAD_TEST_CASE (staged_exception_message_passing) {
+    auto counterActor = ultramarine::get<staged_counter_actor>(1);
+
+    auto fut = counterActor.tell(staged_counter_actor::message::throw_message());
+    auto other = counterActor.tell(staged_counter_actor::message::get_values());
+    BOOST_REQUIRE_THROW(fut.get(), std::runtime_error);
+    other.wait();
+}
+
+/*
+ * Single flight
+ */
+
+SEASTAR_THREAD_TEST_CASE (single_flight_identical_requests_share_execution) {
+    for (int key = 0; key < 2; ++key) {
+        auto ref = ultramarine::get<lookup_actor>(key);
+        auto before = ref.tell(lookup_actor::message::get_executions()).get0();
+
+        std::vector<seastar::future<int>> futs;
+        for (int i = 0; i < 10; ++i) {
+            futs.emplace_back(ref.tell(lookup_actor::message::lookup(), 21));
+        }
+        for (auto &f : futs) {
+            BOOST_REQUIRE(f.get0() == 42);
+        }
+        BOOST_REQUIRE(ref.tell(lookup_actor::message::get_executions()).get0() == before + 1);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (single_flight_distinct_requests_run) {
+    auto ref = ultramarine::get<lookup_actor>(2);
+    auto before = ref.tell(lookup_actor::message::get_executions()).get0();
+
+    auto first = ref.tell(lookup_actor::message::lookup(), 1);
+    auto second = ref.tell(lookup_actor::message::lookup(), 2);
+    auto touch = ref.tell(lookup_actor::message::touch(), 1);
+    auto touch_again = ref.tell(lookup_actor::message::touch(), 1);
+
+    BOOST_REQUIRE(first.get0() == 2);
+    BOOST_REQUIRE(second.get0() == 4);
+    seastar::when_all_succeed(std::move(touch), std::move(touch_again)).wait();
+    BOOST_REQUIRE(ref.tell(lookup_actor::message::get_executions()).get0() == before + 4);
+}
@@ -0,0 +1,178 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdexcept>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/thread.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+
+class migratable_counter_actor : public ultramarine::actor<migratable_counter_actor>,
+                                 public ultramarine::migratable_actor<migratable_counter_actor> {
+ULTRAMARINE_DEFINE_ACTOR(migratable_counter_actor, (increase_counter)(get_counter)(slow_increase)(get_shard));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    int counter = 0;
+
+    void increase_counter() {
+        counter++;
+    }
+
+    int get_counter() const {
+        return counter;
+    }
+
+    seastar::future<> slow_increase() {
+        return seastar::sleep(std::chrono::milliseconds(50)).then([this] {
+            counter++;
+        });
+    }
+
+    seastar::shard_id get_shard() const {
+        return seastar::engine().cpu_id();
+    }
+
+    int export_state() const {
+        return counter;
+    }
+
+    void import_state(int state) {
+        counter = state;
+    }
+};
+
+class failing_export_actor : public ultramarine::actor<failing_export_actor>,
+                             public ultramarine::migratable_actor<failing_export_actor> {
+ULTRAMARINE_DEFINE_ACTOR(failing_export_actor, (get_shard));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    seastar::shard_id get_shard() const {
+        return seastar::engine().cpu_id();
+    }
+
+    int export_state() const {
+        throw std::runtime_error("export failed");
+    }
+
+    void import_state(int) {}
+};
+
+class pinned_range_actor : public ultramarine::actor<pinned_range_actor>,
+                           public ultramarine::migratable_actor<pinned_range_actor>,
+                           public ultramarine::shard_set_actor<pinned_range_actor, ultramarine::shard_range<0, 0>> {
+ULTRAMARINE_DEFINE_ACTOR(pinned_range_actor, (get_shard));
+
+public:
+    seastar::shard_id get_shard() const {
+        return seastar::engine().cpu_id();
+    }
+
+    int export_state() const {
+        return 0;
+    }
+
+    void import_state(int) {}
+};
+
+using namespace seastar;
+
+SEASTAR_THREAD_TEST_CASE (migration_preserves_state) {
+    auto ref = ultramarine::get<migratable_counter_actor>(0);
+    auto to = seastar::smp::count - 1;
+
+    ref.tell(migratable_counter_actor::message::increase_counter()).wait();
+    ref.migrate(to).wait();
+
+    BOOST_REQUIRE(ref.tell(migratable_counter_actor::message::get_counter()).get0() == 1);
+    BOOST_REQUIRE(ref.tell(migratable_counter_actor::message::get_shard()).get0() == to);
+    BOOST_REQUIRE(ultramarine::get<migratable_counter_actor>(0)
+                          .tell(migratable_counter_actor::message::get_shard()).get0() == to);
+}
+
+SEASTAR_THREAD_TEST_CASE (migration_waits_for_pending_messages) {
+    auto ref = ultramarine::get<migratable_counter_actor>(seastar::smp::count);
+
+    auto slow = ref.tell(migratable_counter_actor::message::slow_increase());
+    auto migration = ref.migrate(seastar::smp::count - 1);
+    auto queued = ref.tell(migratable_counter_actor::message::increase_counter());
+
+    seastar::when_all_succeed(std::move(slow), std::move(migration), std::move(queued)).wait();
+    BOOST_REQUIRE(ref.tell(migratable_counter_actor::message::get_counter()).get0() == 2);
+
+    ref.migrate(0).wait();
+    BOOST_REQUIRE(ref.tell(migratable_counter_actor::message::get_counter()).get0() == 2);
+    BOOST_REQUIRE(ref.tell(migratable_counter_actor::message::get_shard()).get0() == 0);
+}
+
+SEASTAR_THREAD_TEST_CASE (rebalance_spreads_hot_activations) {
+    for (std::size_t i = 0; i < 4 * seastar::smp::count; ++i) {
+        auto ref = ultramarine::get<migratable_counter_actor>((i + 2) * seastar::smp::count);
+        for (int j = 0; j < 10; ++j) {
+            ref.tell(migratable_counter_actor::message::increase_counter()).wait();
+        }
+    }
+
+    auto moved = ultramarine::rebalance<migratable_counter_actor>().get0();
+    BOOST_REQUIRE(seastar::smp::count == 1 || moved > 0);
+
+    for (std::size_t i = 0; i < 4 * seastar::smp::count; ++i) {
+        auto ref = ultramarine::get<migratable_counter_actor>((i + 2) * seastar::smp::count);
+        BOOST_REQUIRE(ref.tell(migratable_counter_actor::message::get_counter()).get0() == 10);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (failed_migration_leaves_no_route) {
+    if (seastar::smp::count == 1) {
+        return;
+    }
+    auto ref = ultramarine::get<failing_export_actor>(seastar::smp::count);
+    auto to = seastar::smp::count - 1;
+    auto id = ultramarine::impl::actor_directory<failing_export_actor>::hash_key(seastar::smp::count);
+
+    BOOST_REQUIRE(ref.tell(failing_export_actor::message::get_shard()).get0() == 0);
+    BOOST_REQUIRE_THROW(ref.migrate(to).get(), std::runtime_error);
+
+    BOOST_REQUIRE(!seastar::smp::submit_to(to, [id] {
+        return ultramarine::impl::migration_service<failing_export_actor>::route(id).has_value();
+    }).get0());
+    BOOST_REQUIRE(ref.tell(failing_export_actor::message::get_shard()).get0() == 0);
+}
+
+SEASTAR_THREAD_TEST_CASE (migration_rejects_foreign_shard) {
+    auto ref = ultramarine::get<failing_export_actor>(0);
+
+    BOOST_REQUIRE_THROW(ref.migrate(seastar::smp::count).get(), std::invalid_argument);
+    BOOST_REQUIRE(ref.tell(failing_export_actor::message::get_shard()).get0() == 0);
+
+    if (seastar::smp::count > 1) {
+        auto pinned = ultramarine::get<pinned_range_actor>(0);
+        BOOST_REQUIRE_THROW(pinned.migrate(seastar::smp::count - 1).get(), std::invalid_argument);
+        BOOST_REQUIRE(pinned.tell(pinned_range_actor::message::get_shard()).get0() == 0);
+    }
+}
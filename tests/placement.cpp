@@ -0,0 +1,267 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/thread.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+
+static constexpr std::size_t KeyCount = 90000;
+
+template<typename Strategy>
+std::size_t moved_keys(seastar::shard_id from, seastar::shard_id to) {
+    std::size_t moved = 0;
+    for (std::size_t i = 0; i < KeyCount; ++i) {
+        auto hash = ultramarine::default_key_hasher{}(i);
+        auto before = Strategy::place(hash, from);
+        auto after = Strategy::place(hash, to);
+        BOOST_REQUIRE(before < from && after < to);
+        moved += before != after;
+    }
+    return moved;
+}
+
+template<typename Strategy>
+bool is_balanced(seastar::shard_id count) {
+    std::array<std::size_t, 16> placed{};
+    for (std::size_t i = 0; i < KeyCount; ++i) {
+        ++placed[Strategy::place(ultramarine::default_key_hasher{}(i), count)];
+    }
+    auto expected = KeyCount / count;
+    return std::all_of(std::begin(placed), std::begin(placed) + count, [expected](auto placed) {
+        return placed > expected * 9 / 10 && placed < expected * 11 / 10;
+    });
+}
+
+class jump_actor : public ultramarine::actor<jump_actor,
+        ultramarine::impl::jump_consistent_hash_placement_strategy> {
+ULTRAMARINE_DEFINE_ACTOR(jump_actor, (get_execution_shard));
+
+public:
+    seastar::shard_id get_execution_shard() const {
+        return seastar::engine().cpu_id();
+    }
+};
+
+struct tenant_key {
+    std::size_t tenant = 0;
+    std::size_t id = 0;
+
+    bool operator==(tenant_key const &rhs) const {
+        return tenant == rhs.tenant && id == rhs.id;
+    }
+};
+
+namespace std {
+    template<>
+    struct hash<tenant_key> {
+        std::size_t operator()(tenant_key const &k) const {
+            return k.tenant ^ (k.id << 32U);
+        }
+    };
+}
+
+struct tenant_of {
+    std::size_t operator()(tenant_key const &key) const {
+        return key.tenant;
+    }
+};
+
+class tenant_actor : public ultramarine::actor<tenant_actor,
+        ultramarine::impl::partitioned_placement_strategy<tenant_of>> {
+public:
+    using KeyType = tenant_key;
+
+ULTRAMARINE_DEFINE_ACTOR(tenant_actor, (get_execution_shard));
+
+    seastar::shard_id get_execution_shard() const {
+        return seastar::engine().cpu_id();
+    }
+};
+
+class first_caller_actor : public ultramarine::actor<first_caller_actor,
+        ultramarine::impl::first_caller_placement_strategy<>> {
+ULTRAMARINE_DEFINE_ACTOR(first_caller_actor, (get_execution_shard));
+
+public:
+    seastar::shard_id get_execution_shard() const {
+        return seastar::engine().cpu_id();
+    }
+};
+
+class numa_node_actor : public ultramarine::actor<numa_node_actor,
+        ultramarine::impl::numa_node_placement_strategy<1>> {
+ULTRAMARINE_DEFINE_ACTOR(numa_node_actor, (get_execution_shard));
+
+public:
+    seastar::shard_id get_execution_shard() const {
+        return seastar::engine().cpu_id();
+    }
+};
+
+class numa_tenant_actor : public ultramarine::actor<numa_tenant_actor,
+        ultramarine::impl::numa_partitioned_placement_strategy<tenant_of>> {
+public:
+    using KeyType = tenant_key;
+
+ULTRAMARINE_DEFINE_ACTOR(numa_tenant_actor, (get_execution_shard));
+
+    seastar::shard_id get_execution_shard() const {
+        return seastar::engine().cpu_id();
+    }
+};
+
+class last_shard_actor : public ultramarine::actor<last_shard_actor>,
+                         public ultramarine::shard_set_actor<last_shard_actor, ultramarine::shard_range<1024, 1024>> {
+ULTRAMARINE_DEFINE_ACTOR(last_shard_actor, (get_execution_shard));
+
+public:
+    seastar::shard_id get_execution_shard() const {
+        return seastar::engine().cpu_id();
+    }
+};
+
+struct compute_shards;
+
+class compute_worker : public ultramarine::actor<compute_worker>,
+                       public ultramarine::local_actor<compute_worker>,
+                       public ultramarine::shard_set_actor<compute_worker, ultramarine::shard_set<compute_shards>> {
+ULTRAMARINE_DEFINE_ACTOR(compute_worker, (get_execution_shard));
+
+public:
+    seastar::shard_id get_execution_shard() const {
+        return seastar::engine().cpu_id();
+    }
+};
+
+SEASTAR_THREAD_TEST_CASE (placement_balance) {
+    for (seastar::shard_id count : {1, 3, 8, 12, 16}) {
+        BOOST_CHECK(is_balanced<ultramarine::impl::round_robin_local_placement_strategy>(count));
+        BOOST_CHECK(is_balanced<ultramarine::impl::jump_consistent_hash_placement_strategy>(count));
+        BOOST_CHECK(is_balanced<ultramarine::impl::rendezvous_placement_strategy>(count));
+        BOOST_CHECK(is_balanced<ultramarine::impl::power_of_two_placement_strategy>(count));
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (placement_minimal_movement) {
+    // Going from 8 to 9 shards should only move about a ninth of the keys
+    BOOST_CHECK(moved_keys<ultramarine::impl::jump_consistent_hash_placement_strategy>(8, 9) < KeyCount / 8);
+    BOOST_CHECK(moved_keys<ultramarine::impl::rendezvous_placement_strategy>(8, 9) < KeyCount / 8);
+}
+
+SEASTAR_THREAD_TEST_CASE (placement_contiguous_ranges) {
+    using strategy = ultramarine::impl::contiguous_placement_strategy<100>;
+
+    BOOST_CHECK(strategy::place(0, 4) == 0);
+    BOOST_CHECK(strategy::place(24, 4) == 0);
+    BOOST_CHECK(strategy::place(25, 4) == 1);
+    BOOST_CHECK(strategy::place(99, 4) == 3);
+    BOOST_CHECK(strategy::place(100, 4) == 0);
+}
+
+SEASTAR_THREAD_TEST_CASE (placement_strategy_location) {
+    for (ultramarine::actor_id key = 0; key < 16; ++key) {
+        auto expected = ultramarine::impl::jump_consistent_hash_placement_strategy{}(
+                ultramarine::default_key_hasher{}(key));
+        BOOST_CHECK(ultramarine::get<jump_actor>(key)->get_execution_shard().get0() == expected);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (placement_partitioned_collocation) {
+    for (std::size_t tenant = 0; tenant < 16; ++tenant) {
+        auto shard = ultramarine::get<tenant_actor>(tenant_key{tenant, 0})->get_execution_shard().get0();
+        for (std::size_t id = 1; id < 8; ++id) {
+            BOOST_CHECK(ultramarine::get<tenant_actor>(tenant_key{tenant, id})->get_execution_shard().get0() == shard);
+        }
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (placement_first_caller) {
+    auto caller = (seastar::engine().cpu_id() + 1) % seastar::smp::count;
+
+    auto shard = seastar::smp::submit_to(caller, [] {
+        return ultramarine::get<first_caller_actor>(42)->get_execution_shard();
+    }).get0();
+
+    BOOST_CHECK(shard == caller);
+    BOOST_CHECK(ultramarine::get<first_caller_actor>(42)->get_execution_shard().get0() == caller);
+    BOOST_CHECK(ultramarine::get<first_caller_actor>(43)->get_execution_shard().get0() == seastar::engine().cpu_id());
+}
+
+SEASTAR_THREAD_TEST_CASE (placement_numa_nodes) {
+    // Simulates two sockets, each holding half of the shards
+    std::vector<unsigned> nodes(seastar::smp::count);
+    for (seastar::shard_id shard = 0; shard < seastar::smp::count; ++shard) {
+        nodes[shard] = shard >= seastar::smp::count / 2;
+    }
+    ultramarine::set_numa_topology(nodes);
+    auto second_node = nodes.back();
+
+    for (std::size_t key = 0; key < 64; ++key) {
+        auto shard = ultramarine::get<numa_node_actor>(key)->get_execution_shard().get0();
+        BOOST_CHECK(nodes[shard] == second_node);
+    }
+    for (std::size_t tenant = 0; tenant < 16; ++tenant) {
+        auto node = nodes[ultramarine::get<numa_tenant_actor>(tenant_key{tenant, 0})->get_execution_shard().get0()];
+        for (std::size_t id = 1; id < 8; ++id) {
+            auto shard = ultramarine::get<numa_tenant_actor>(tenant_key{tenant, id})->get_execution_shard().get0();
+            BOOST_CHECK(nodes[shard] == node);
+        }
+    }
+
+    ultramarine::set_numa_topology(std::vector<unsigned>(seastar::smp::count));
+}
+
+SEASTAR_THREAD_TEST_CASE (placement_shard_set) {
+    auto last = seastar::smp::count - 1;
+    for (std::size_t key = 0; key < 16; ++key) {
+        BOOST_CHECK(ultramarine::get<last_shard_actor>(key)->get_execution_shard().get0() == last);
+    }
+
+    ultramarine::assign_shards<compute_shards>({0, last});
+    for (std::size_t i = 0; i < 16; ++i) {
+        auto shard = ultramarine::get<compute_worker>(0)->get_execution_shard().get0();
+        BOOST_CHECK(shard == 0 || shard == last);
+    }
+}
+
+struct repeated_shards;
+
+SEASTAR_THREAD_TEST_CASE (shard_set_ignores_repeated_shards) {
+    using set = ultramarine::shard_set<repeated_shards>;
+    auto last = seastar::smp::count - 1;
+
+    BOOST_REQUIRE(ultramarine::assign_shards<repeated_shards>({last, 0, last, 0}));
+    BOOST_REQUIRE(set::count() == (last ? 2 : 1));
+    BOOST_REQUIRE(set::index_of(last) == 0);
+    BOOST_REQUIRE(set::at(set::index_of(0)) == 0);
+
+    BOOST_REQUIRE(!ultramarine::assign_shards<repeated_shards>({0}));
+    BOOST_REQUIRE(set::count() == (last ? 2 : 1));
+    BOOST_REQUIRE(set::index_of(last) == 0);
+}
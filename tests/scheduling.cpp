@@ -0,0 +1,153 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2018 Hippolyte Barraud
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <seastar/testing/thread_test_case.hh>
+#include <seastar/core/thread.hh>
+#include <ultramarine/actor.hpp>
+#include <ultramarine/actor_ref.hpp>
+
+struct latency_group {
+    static constexpr char const *name = "latency";
+    static constexpr float shares = 1000;
+};
+
+struct throughput_group {
+    static constexpr char const *name = "throughput";
+    static constexpr float shares = 100;
+};
+
+class grouped_actor : public ultramarine::actor<grouped_actor>,
+                      public ultramarine::scheduling_group_actor<grouped_actor, latency_group> {
+ULTRAMARINE_DEFINE_ACTOR(grouped_actor, (current_group)(current_group_async)(background_group));
+
+public:
+    seastar::scheduling_group current_group() const {
+        return seastar::current_scheduling_group();
+    }
+
+    seastar::future<seastar::scheduling_group> current_group_async() const {
+        return seastar::later().then([] {
+            return seastar::current_scheduling_group();
+        });
+    }
+
+    seastar::scheduling_group background_group() const {
+        return seastar::current_scheduling_group();
+    }
+
+    static throughput_group scheduling_group_of(decltype(message::background_group()));
+};
+
+class unscheduled_actor : public ultramarine::actor<unscheduled_actor> {
+ULTRAMARINE_DEFINE_ACTOR(unscheduled_actor, (current_group));
+
+public:
+    seastar::scheduling_group current_group() const {
+        return seastar::current_scheduling_group();
+    }
+};
+
+class grouped_deactivatable_actor : public ultramarine::actor<grouped_deactivatable_actor>,
+                                    public ultramarine::deactivatable_actor<grouped_deactivatable_actor>,
+                                    public ultramarine::scheduling_group_actor<grouped_deactivatable_actor,
+                                            throughput_group> {
+ULTRAMARINE_DEFINE_ACTOR(grouped_deactivatable_actor, (increase_counter)(get_counter));
+
+public:
+    using Hasher = ultramarine::identity_key_hasher;
+
+    int counter = 0;
+
+    void increase_counter() {
+        counter++;
+    }
+
+    int get_counter() const {
+        return counter;
+    }
+};
+
+using namespace seastar;
+
+static void create_groups() {
+    static bool created = false;
+    if (!created) {
+        ultramarine::create_scheduling_group<latency_group>().wait();
+        ultramarine::create_scheduling_group<throughput_group>().wait();
+        created = true;
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (actor_messages_run_in_actor_group) {
+    create_groups();
+    auto latency = ultramarine::impl::scheduling_groups<latency_group>::group;
+
+    for (std::size_t i = 0; i < 2 * seastar::smp::count; ++i) {
+        auto ref = ultramarine::get<grouped_actor>(i);
+        BOOST_REQUIRE(ref.tell(grouped_actor::message::current_group()).get0() == latency);
+        BOOST_REQUIRE(ref.tell(grouped_actor::message::current_group_async()).get0() == latency);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (message_group_overrides_actor_group) {
+    create_groups();
+    auto throughput = ultramarine::impl::scheduling_groups<throughput_group>::group;
+
+    for (std::size_t i = 0; i < 2 * seastar::smp::count; ++i) {
+        auto ref = ultramarine::get<grouped_actor>(i);
+        BOOST_REQUIRE(ref.tell(grouped_actor::message::background_group()).get0() == throughput);
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (unscheduled_actor_runs_in_default_group) {
+    create_groups();
+
+    for (std::size_t i = 0; i < 2 * seastar::smp::count; ++i) {
+        auto ref = ultramarine::get<unscheduled_actor>(i);
+        auto group = ref.tell(unscheduled_actor::message::current_group()).get0();
+        BOOST_REQUIRE(group == seastar::default_scheduling_group());
+    }
+}
+
+SEASTAR_THREAD_TEST_CASE (deactivation_waits_for_messages_switching_group) {
+    create_groups();
+    auto ref = ultramarine::get<grouped_deactivatable_actor>(0);
+
+    // The message switches to its group in a later task, after the deactivation request
+    auto message = ref.tell(grouped_deactivatable_actor::message::increase_counter());
+    auto deactivation = ref.deactivate();
+    BOOST_REQUIRE(!deactivation.available());
+    message.wait();
+    deactivation.wait();
+    BOOST_REQUIRE(ref.tell(grouped_deactivatable_actor::message::get_counter()).get0() == 0);
+}
+
+SEASTAR_THREAD_TEST_CASE (groups_are_published_to_every_shard) {
+    create_groups();
+    auto latency = ultramarine::impl::scheduling_groups<latency_group>::group;
+
+    seastar::smp::invoke_on_all([latency] {
+        BOOST_REQUIRE(ultramarine::impl::scheduling_groups<latency_group>::group == latency);
+    }).wait();
+}